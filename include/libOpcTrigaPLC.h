@@ -22,6 +22,51 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <iostream>
 #include <stdexcept>
 #include <chrono>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+#include <utility>
+
+// Índice de cada canal lido do PLC, na mesma ordem dos campos de PLC_DATA
+enum PLC_CHANNEL
+{
+  CH_BarraReg,
+  CH_BarraCon,
+  CH_BarraSeg,
+  CH_CLinScale,
+  CH_CLin,
+  CH_CPer,
+  CH_CLogARea,
+  CH_CLogALin,
+  CH_CLogALog,
+  CH_CLogAPer,
+  CH_CParALin,
+  CH_CParALog,
+  CH_CParAPer,
+  CH_SRadAre,
+  CH_SRadEntPri,
+  CH_SRadPoc,
+  CH_SRadRes,
+  CH_SRadSaiSec,
+  CH_SRadAer,
+  CH_SVasPri,
+  PLC_N_CHANNELS
+};
+
+// Conjunto de canais: bit (1 << PLC_CHANNEL) de cada canal
+typedef uint32_t PLC_MASK;
+constexpr PLC_MASK PLC_MASK_ALL = (PLC_MASK(1) << PLC_N_CHANNELS) - 1;
+
+constexpr PLC_MASK plcMask(std::initializer_list<PLC_CHANNEL> channels)
+{
+  PLC_MASK mask = 0;
+  for (PLC_CHANNEL ch : channels) mask |= PLC_MASK(1) << ch;
+  return mask;
+}
 
 struct PLC_DATA
 {
@@ -30,7 +75,12 @@ struct PLC_DATA
                   //  0 = Valores lidos com sucesso.
                   //  1 = Erro de leitura
                   //  2 = Servidor desconectado
+                  //  3 = Leitura parcial, algum canal com erro (ver STATUS)
   std::chrono::system_clock::time_point TIME;
+  std::array<uint32_t, PLC_N_CHANNELS> STATUS{}; // StatusCode OPC UA de cada canal (índice PLC_CHANNEL), 0 = Good
+                                                 // Canais com StatusCode Bad ficam com valor -1 (ver plcStatusUsable())
+  PLC_MASK MASK = 0; // Canais atualizados nesta leitura. Os demais ficam com valor -1
+  bool STALE = false; // true = valores não atualizados nesta chamada (últimos dados conhecidos)
   // 
   float BarraReg      = -1; //ns=2;s=IoConfig_Globals_Mapping.inBarraReg (%IW5)   //Barra de Regulação
   float BarraCon      = -1; //ns=2;s=IoConfig_Globals_Mapping.inBarraCon (%IW6)   //Barra de Controle
@@ -54,18 +104,47 @@ struct PLC_DATA
   float SVasPri       = -1; //ns=2;IoConfig_Globals_Mapping.inSVasPri (%IW49)     //Sensor Vazão Sistema Primário de Refrigeração
 };
 
+// true se o valor de um canal com este StatusCode é utilizável: Good (inclusive subcódigos
+// como GoodClamped) ou Uncertain. Equivale a !UA_StatusCode_isBad(status).
+inline bool plcStatusUsable(uint32_t status)
+{
+  return (status >> 30) < 2;
+}
+
+// Timestamps OPC UA de um canal. Zero quando o servidor não informou o timestamp
+// ou o canal não foi atualizado (o StatusCode do canal fica em PLC_DATA::STATUS).
+struct PLC_CHANNEL_TIME
+{
+  std::chrono::system_clock::time_point source; // SourceTimestamp: instante da amostragem no PLC
+  std::chrono::system_clock::time_point server; // ServerTimestamp: instante em que o servidor obteve o valor
+};
+
+// Snapshot com a temporização de cada canal, ver libOpcTrigaPLC::get_all_ex()
+struct PLC_DATA_EX
+{
+  PLC_DATA data;
+  std::array<PLC_CHANNEL_TIME, PLC_N_CHANNELS> time{}; // Índice PLC_CHANNEL
+  std::chrono::steady_clock::time_point sent;     // Envio da requisição Read (relógio monotônico)
+  std::chrono::steady_clock::time_point received; // Recepção da resposta ou da notificação (relógio monotônico)
+  std::chrono::nanoseconds rtt{0};                // received - sent; 0 no modo subscription
+};
+
 struct CONV_LIN
 {
   float x0 =  0;
   float x1 =  1;
   float y0 = -2;
   float y1 = -2;
+
+  bool operator==(const CONV_LIN&) const = default;
 };
 
 struct CONV_LOG
 {
   double A = -2;
   double B =  0;
+
+  bool operator==(const CONV_LOG&) const = default;
 };
 
 struct CONV_PER
@@ -74,6 +153,8 @@ struct CONV_PER
   double L = 0;//Multiplicação
   //double M = 0;
   //double N = 0;
+
+  bool operator==(const CONV_PER&) const = default;
 };
 
 struct CONV_PLC {
@@ -96,31 +177,392 @@ struct CONV_PLC {
   CONV_LOG SRadSaiSec;
   CONV_LOG SRadAer;
   CONV_LIN SVasPri;
+
+  bool operator==(const CONV_PLC&) const = default;
+};
+
+// Parâmetros do modo subscription (push), ver libOpcTrigaPLC::startSubscription()
+struct SUB_CONFIG
+{
+  double   samplingInterval   = 100; // Intervalo de amostragem de cada canal no servidor (ms)
+  double   publishingInterval = 100; // Intervalo de publicação das notificações (ms)
+  uint32_t queueSize          = 1;   // Tamanho da fila de cada MonitoredItem
+};
+
+// Tipo do valor bruto lido do PLC
+enum PLC_RAW_TYPE
+{
+  RAW_INT16,       // Int16, guardado como float em PLC_DATA
+  RAW_SCALE_BITS,  // UInt16 com bits de escala, guardado como int em PLC_DATA (CLinScale)
 };
 
+// Tipo de conversão aplicada por convAllData() e fatores usados em CONV_PLC
+enum PLC_CONV_KIND
+{
+  CONV_KIND_NONE, // Sem conversão
+  CONV_KIND_LIN,  // CONV_LIN
+  CONV_KIND_LOG,  // CONV_LOG
+  CONV_KIND_PER,  // CONV_PER
+};
+
+// Descrição de um canal do PLC
+struct PLC_CHANNEL_INFO
+{
+  const char*   name;       // Nome do campo em PLC_DATA e da seção no arquivo de conversão
+  const char*   nodeId;     // NodeId string no namespace 2 do servidor OPC UA do PLC
+  PLC_RAW_TYPE  rawType;
+  PLC_CONV_KIND convKind;
+  size_t        dataOffset; // Posição do campo em PLC_DATA
+  size_t        convOffset; // Posição dos fatores em CONV_PLC (não usado se CONV_KIND_NONE)
+};
+
+// Tabela única de canais, no índice PLC_CHANNEL
+#define PLC_CH_LIN(NAME, NODE) { #NAME, "IoConfig_Globals_Mapping." NODE, RAW_INT16, CONV_KIND_LIN, offsetof(PLC_DATA, NAME), offsetof(CONV_PLC, NAME) }
+#define PLC_CH_LOG(NAME, NODE) { #NAME, "IoConfig_Globals_Mapping." NODE, RAW_INT16, CONV_KIND_LOG, offsetof(PLC_DATA, NAME), offsetof(CONV_PLC, NAME) }
+#define PLC_CH_PER(NAME, NODE) { #NAME, "IoConfig_Globals_Mapping." NODE, RAW_INT16, CONV_KIND_PER, offsetof(PLC_DATA, NAME), offsetof(CONV_PLC, NAME) }
+
+inline constexpr PLC_CHANNEL_INFO PLC_CHANNELS[PLC_N_CHANNELS] = {
+  PLC_CH_LIN(BarraReg,   "inBarraReg (%IW5)"),    //Converter bits para "posições de barra"
+  PLC_CH_LIN(BarraCon,   "inBarraCon (%IW6)"),
+  PLC_CH_LIN(BarraSeg,   "inBarraSeg (%IW7)"),
+  { "CLinScale", "IoConfig_Globals_Mapping.inModule_D0 (%IW0)", RAW_SCALE_BITS, CONV_KIND_NONE, offsetof(PLC_DATA, CLinScale), 0 },
+  PLC_CH_LIN(CLin,       "inCLin (%IW8)"),
+  PLC_CH_LIN(CPer,       "inCPer (%IW13)"),
+  PLC_CH_LIN(CLogARea,   "inCLogARea (%IW14)"),
+  PLC_CH_LIN(CLogALin,   "inCLogALin (%IW15)"),   //Converter bits para W
+  PLC_CH_LOG(CLogALog,   "inCLogALog (%IW16)"),
+  PLC_CH_PER(CLogAPer,   "inCLogAPer (%IW17)"),
+  PLC_CH_LIN(CParALin,   "inCParALin (%IW18)"),
+  PLC_CH_LOG(CParALog,   "inCParALog (%IW19)"),
+  PLC_CH_PER(CParAPer,   "inCParAPer (%IW20)"),
+  PLC_CH_LOG(SRadAre,    "inSRadAre (%IW25)"),
+  PLC_CH_LOG(SRadEntPri, "inSRadEntPri (%IW26)"),
+  PLC_CH_LOG(SRadPoc,    "inSRadPoc (%IW27)"),
+  PLC_CH_LOG(SRadRes,    "inSRadRes (%IW28)"),
+  PLC_CH_LOG(SRadSaiSec, "inSRadSaiSec (%IW29)"),
+  PLC_CH_LOG(SRadAer,    "inSRadAer (%IW30)"),
+  PLC_CH_LIN(SVasPri,    "inSVasPri (%IW49)"),    //Converter bits para m^3/h
+};
+
+#undef PLC_CH_LIN
+#undef PLC_CH_LOG
+#undef PLC_CH_PER
+
+// Acesso ao campo de um canal em PLC_DATA (todos float, exceto CLinScale)
+inline float& plcField(PLC_DATA& data, int ch)
+{
+  return *reinterpret_cast<float*>(reinterpret_cast<char*>(&data) + PLC_CHANNELS[ch].dataOffset);
+}
+inline float plcField(const PLC_DATA& data, int ch)
+{
+  return *reinterpret_cast<const float*>(reinterpret_cast<const char*>(&data) + PLC_CHANNELS[ch].dataOffset);
+}
+
+// Estado da conexão com o servidor OPC UA do PLC
+enum PLC_CONN_STATE
+{
+  CONN_DISCONNECTED,
+  CONN_CONNECTING,
+  CONN_CONNECTED,
+};
+
+// Parâmetros da reconexão automática, ver libOpcTrigaPLC::enableAutoReconnect()
+struct RECONNECT_CONFIG
+{
+  std::chrono::milliseconds initialDelay{100};   // Espera após a primeira falha
+  std::chrono::milliseconds maxDelay{10000};     // Espera máxima entre tentativas
+  double   multiplier = 2;                       // Crescimento exponencial da espera
+  double   jitter     = 0.2;                     // Variação aleatória da espera (+/- fração)
+  uint32_t timeoutMs  = 2000;                    // Timeout de conexão e de cada requisição
+};
+
+// Estatísticas de um ciclo da aquisição em segundo plano
+struct PLC_CYCLE
+{
+  uint64_t cycle  = 0; // Número do ciclo
+  uint64_t missed = 0; // Total de prazos perdidos (ciclos pulados por atraso) até este ciclo
+  std::chrono::steady_clock::time_point deadline; // Início programado do ciclo
+  std::chrono::steady_clock::time_point start;    // Início real do ciclo
+  std::chrono::nanoseconds jitter{0};             // start - deadline
+  std::chrono::nanoseconds readLatency{0};        // Duração da leitura do PLC
+};
+
+// Parâmetros da aquisição em segundo plano, ver libOpcTrigaPLC::startAcquisition()
+struct ACQ_CONFIG
+{
+  std::chrono::nanoseconds period{std::chrono::milliseconds(100)};
+  int rtPriority = 0;  // > 0: executa a thread em SCHED_FIFO com esta prioridade (requer permissão)
+  int cpu        = -1; // >= 0: fixa a thread nesta CPU
+  std::function<void(const PLC_DATA&, const PLC_CYCLE&)> callback; // Chamado na thread de aquisição a cada ciclo
+};
+
+// Bloco de amostras brutas em colunas (structure-of-arrays): uma coluna contígua
+// de n valores por canal, no índice PLC_CHANNEL. Colunas nulas são ignoradas.
+struct PLC_BLOCK_RAW
+{
+  const int16_t* col[PLC_N_CHANNELS] = {};
+  size_t n = 0;
+};
+
+// Colunas de saída de convBlock(), com pelo menos n valores cada
+struct PLC_BLOCK_CONV
+{
+  float* col[PLC_N_CHANNELS] = {};
+};
+
+// Resumo de um histograma de latência, em nanossegundos
+struct PLC_STATS_HIST
+{
+  uint64_t count = 0;
+  uint64_t sum   = 0;
+  double   mean  = 0;
+  uint64_t p50   = 0;
+  uint64_t p90   = 0;
+  uint64_t p99   = 0;
+  uint64_t p999  = 0;
+  uint64_t max   = 0;
+};
+
+// Estatísticas de execução acumuladas desde enableStats() ou resetStats()
+struct PLC_STATS
+{
+  bool     enabled         = false;
+  uint64_t connectAttempts = 0; // Chamadas a tryConnect() (inclusive pela reconexão automática)
+  uint64_t connectFailures = 0;
+  uint64_t disconnects     = 0; // Perdas de conexão detectadas
+  uint64_t reads           = 0; // Requisições Read enviadas
+  uint64_t readErrors      = 0; // Requisições Read que falharam por completo
+  std::array<uint64_t,PLC_N_CHANNELS> channelErrors{}; // Leituras de cada canal com StatusCode ruim
+  std::vector<std::pair<uint32_t,uint64_t>> statusErrors; // (StatusCode, ocorrências), de leituras e de canais
+  PLC_STATS_HIST readTime;  // Duração de cada requisição Read (todos os canais pedidos)
+  PLC_STATS_HIST cycleTime; // Duração de cada ciclo da aquisição em segundo plano
+  PLC_STATS_HIST convTime;  // Duração de cada convAllData()/convBlock()
+};
+
+// Tipo de um erro relatado pela biblioteca
+enum PLC_ERROR_CODE
+{
+  ERR_CONNECT,      // Falha ao conectar ao servidor OPC UA
+  ERR_DISCONNECTED, // Operação sem conexão ou conexão perdida
+  ERR_READ,         // Requisição Read falhou com o cliente conectado
+  ERR_CHANNEL,      // Canal lido com StatusCode ruim
+  ERR_SUBSCRIPTION, // Falha ao criar a subscription
+  ERR_THREAD,       // Falha ao configurar a thread de aquisição (afinidade, prioridade)
+  ERR_FILE,         // Falha ao ler ou gravar arquivo
+};
+
+// Erro entregue ao destino de erros, ver libOpcTrigaPLC::setErrorSink().
+// Os ponteiros valem apenas durante a chamada do callback.
+struct PLC_ERROR
+{
+  PLC_ERROR_CODE code;
+  const char* function;    // Função pública em que ocorreu, ex.: "get_all()"
+  const char* message;     // Descrição do erro
+  const char* detail;      // Informação adicional (ex.: strerror, nome de arquivo) ou nullptr
+  uint32_t    status  = 0;  // StatusCode OPC UA, 0 (Good) se não se aplica
+  int         channel = -1; // PLC_CHANNEL ou -1
+  uint64_t    suppressed = 0; // Destino padrão: repetições omitidas desde o último relato deste erro
+};
+
+// Banda morta de um canal, lida do arquivo de conversão (chaves deadband e deadband_pct
+// na seção do canal). Uma mudança só é reportada se |valor - último reportado| for maior
+// que abs e que pct % de |último reportado|. Zero em ambos: qualquer mudança é reportada.
+struct PLC_DEADBAND
+{
+  float abs = 0;
+  float pct = 0;
+};
+typedef std::array<PLC_DEADBAND, PLC_N_CHANNELS> PLC_DEADBANDS;
+
+// Mudança de um canal reportada pelo filtro de banda morta
+struct PLC_CHANGE
+{
+  PLC_CHANNEL channel;
+  float       value;  // Valor do canal no snapshot filtrado
+  uint32_t    status; // StatusCode OPC UA do canal
+  std::chrono::system_clock::time_point time; // PLC_DATA::TIME do snapshot
+};
+
+// Filtro de mudanças: compara cada snapshot com o último valor reportado de cada canal
+// e retorna apenas os canais que saíram da banda morta ou mudaram de StatusCode.
+// Canais fora de PLC_DATA::MASK são ignorados. Um filtro por consumidor.
+class libOpcTrigaPLCChangeFilter {
+public:
+  libOpcTrigaPLCChangeFilter(const PLC_DEADBANDS& deadbands = {});
+
+  void setDeadbands(const PLC_DEADBANDS& deadbands);
+  bool readDeadbandFile(std::string filename); // Retorna 0 em caso de sucesso e 1 em caso de erro
+  void reset(); // O próximo snapshot reporta todos os canais
+
+  // Acrescenta a changes as mudanças de data e retorna quantas foram acrescentadas
+  size_t filter(const PLC_DATA& data, std::vector<PLC_CHANGE>& changes);
+
+private:
+  PLC_DEADBANDS deadbands;
+  std::array<float, PLC_N_CHANNELS>    last{};
+  std::array<uint32_t, PLC_N_CHANNELS> lastStatus{};
+  PLC_MASK reported = 0;
+};
+
+// Nome padrão do segmento de memória compartilhada, ver libOpcTrigaPLC::startShmPublisher()
+inline constexpr const char* PLC_SHM_DEFAULT_NAME = "/libOpcTrigaPLC";
+
 void libOpcTrigaPLC_license();
 
 struct libOpcTrigaPLC_private;
+struct CONV_TABLE;
+class libOpcTrigaPLCHistory;
 
 class libOpcTrigaPLC {
 public:
   libOpcTrigaPLC(std::string address);
   libOpcTrigaPLC(std::string address, std::string filename);
+  libOpcTrigaPLC(CONV_PLC fatorConv); // Sem conexão com o PLC, apenas conversão (ex.: reprocessar gravações)
   ~libOpcTrigaPLC();
 
-  CONV_PLC fatorConv;
+  // Lê o arquivo de conversão, passa a usar os fatores lidos e os retorna
   CONV_PLC readFatorConvFile(std::string filename);
 
+  // Fatores de conversão com troca atômica: cada conversão usa a tabela vigente no seu
+  // início e termina com ela, enquanto novas conversões já usam a nova, sem locks nem
+  // pausa na aquisição. getFatorConv() retorna os fatores em uso e setFatorConv() os
+  // substitui (ex.: para alterar um fator, getFatorConv(), alterar a cópia e setFatorConv()).
+  CONV_PLC getFatorConv();
+  void setFatorConv(const CONV_PLC& fatorConv);
+
+  // Recarga do arquivo de conversão (o último lido por readFatorConvFile() ou o passado
+  // a watchFatorConvFile()). O arquivo é lido e compilado fora do caminho de conversão;
+  // um arquivo inválido mantém os fatores em uso. watchFatorConvFile() recarrega
+  // automaticamente a cada vez que o arquivo é salvo (inotify).
+  // Retornam 0 em caso de sucesso e 1 em caso de erro.
+  bool reloadFatorConvFile();
+  bool watchFatorConvFile(std::string filename = "");
+  void unwatchFatorConvFile();
+
   PLC_DATA convAllData(PLC_DATA plcOrig);
+  PLC_DATA convAllData(PLC_DATA plcOrig, PLC_MASK mask); // Converte apenas os canais de mask
+  void convBlock(const PLC_BLOCK_RAW& raw, PLC_BLOCK_CONV& conv); // Conversão em lote, coluna a coluna
   PLC_DATA get_all_conv();
   PLC_DATA get_all();
+
+  // Leitura seletiva: lê (e converte) apenas os canais de mask, ex.:
+  // get_all(plcMask({CH_BarraReg, CH_BarraCon, CH_BarraSeg})).
+  // Os demais canais ficam com valor -1 e fora de PLC_DATA::MASK.
+  PLC_DATA get_all_conv(PLC_MASK mask);
+  PLC_DATA get_all(PLC_MASK mask);
+
+  // Como get_all(), acrescentando os timestamps de origem e do servidor de cada canal,
+  // o instante monotônico de recepção e a latência (ida e volta) da requisição Read.
+  // PLC_DATA::TIME continua sendo o relógio local após a leitura; para o instante real
+  // da amostragem de um canal use time[ch].source.
+  PLC_DATA_EX get_all_ex();
+  PLC_DATA_EX get_all_ex(PLC_MASK mask);
+  PLC_DATA_EX get_latest_ex(); // Último snapshot estendido publicado (não bloqueia)
   bool tryConnect();
 
+  // Modo subscription: cria uma subscription com um MonitoredItem por canal.
+  // As notificações DataChange processadas em cada runIterate() (normalmente uma por
+  // canal alterado a cada intervalo de publicação) atualizam o snapshot interno, que é
+  // então publicado (memória compartilhada, histórico) e passado ao callback (opcional)
+  // uma única vez, com todos os canais do lote.
+  // Com a subscription ativa, get_all() apenas processa as notificações pendentes
+  // e retorna o snapshot, sem enviar requisições Read.
+  // Retorna 0 em caso de sucesso e 1 em caso de erro, como tryConnect().
+  bool startSubscription(SUB_CONFIG config = {}, std::function<void(const PLC_DATA&)> callback = nullptr);
+  void stopSubscription();
+  bool runIterate(uint16_t timeoutMs = 0); // Processa as notificações recebidas (chama os callbacks)
+
+  // Reconexão automática: uma thread interna (re)conecta em segundo plano com espera
+  // exponencial e jitter, resolve novamente os canais e recria a subscription, se houver.
+  // A partir daí get_all() nunca espera pela rede durante a conexão: sem conexão retorna
+  // os últimos dados conhecidos com STALE = true e STATE = 2.
+  // Retorna 0 em caso de sucesso e 1 se já estava ativa.
+  bool enableAutoReconnect(RECONNECT_CONFIG config = {});
+  void disableAutoReconnect();
+  PLC_CONN_STATE getConnState() const;
+
+  // Aquisição em segundo plano: uma thread interna passa a ser a dona do cliente OPC
+  // e lê o PLC a cada período, publicando o último snapshot bruto e convertido.
+  // Os ciclos seguem prazos absolutos no relógio monotônico (sem acúmulo de deriva);
+  // ciclos cujo prazo já passou são pulados e contados em PLC_CYCLE::missed.
+  // Enquanto ativa, get_all()/get_all_conv() retornam o último snapshot publicado
+  // sem acessar a rede, e podem ser chamadas de qualquer thread.
+  // Retorna 0 em caso de sucesso e 1 se a aquisição já estava ativa.
+  bool startAcquisition(ACQ_CONFIG config);
+  bool startAcquisition(std::chrono::microseconds period);
+  void stopAcquisition();
+  bool isAcquiring() const;
+  // Últimos snapshots obtidos pela aquisição em segundo plano, pela subscription ou, sem
+  // elas, pela última chamada a get_all()/get_all_conv() (não bloqueiam). Sem aquisição,
+  // get_latest_conv() só é atualizado por get_all_conv() e pela subscription.
+  PLC_DATA get_latest();      // Último snapshot bruto
+  PLC_DATA get_latest_conv(); // Último snapshot convertido
+  PLC_CYCLE get_latest_cycle(); // Estatísticas do último ciclo de aquisição (não bloqueia)
+
+  // Fluxo de mudanças: obtém um snapshot convertido (como get_all_conv()) e acrescenta a
+  // changes apenas os canais que mudaram além da banda morta desde a chamada anterior.
+  // As bandas mortas vêm do arquivo de conversão e acompanham suas recargas.
+  // Retorna o número de mudanças acrescentadas.
+  size_t get_changes(std::vector<PLC_CHANGE>& changes);
+  void resetChanges(); // A próxima chamada a get_changes() reporta todos os canais
+  PLC_DEADBANDS getDeadbands();
+  void setDeadbands(const PLC_DEADBANDS& deadbands);
+
+  // Estatísticas de execução: contadores atômicos e histogramas de latência mantidos
+  // pela própria biblioteca. Desativadas por padrão; desativadas custam uma leitura
+  // atômica por ponto instrumentado. getStats() pode ser chamada de qualquer thread.
+  // dumpStatsPrometheus() grava as estatísticas no formato texto do Prometheus
+  // (ex.: para o textfile collector do node_exporter), substituindo o arquivo
+  // atomicamente. Retorna 0 em caso de sucesso e 1 em caso de erro.
+  void enableStats(bool enable = true);
+  void resetStats();
+  PLC_STATS getStats() const;
+  bool dumpStatsPrometheus(std::string filename);
+
+  // Destino dos erros. Por padrão são escritos em std::cerr e erros repetidos (mesmo
+  // código, função, StatusCode e canal) são relatados no máximo uma vez por intervalo,
+  // com o número de repetições omitidas. Falhas de leitura são tratadas por StatusCode,
+  // sem exceções nem alocações até chegar ao destino.
+  // setErrorSink() entrega todos os erros, sem limite, ao callback, chamado na thread
+  // em que o erro ocorreu; nullptr restaura o destino padrão. O callback não pode
+  // chamar setErrorSink().
+  void setErrorSink(std::function<void(const PLC_ERROR&)> sink);
+  void setErrorRateLimit(std::chrono::milliseconds interval); // Padrão: 10 s
+
+  // Modo publicador: cada snapshot obtido pela aquisição em segundo plano, pela
+  // subscription ou por get_all_conv() é publicado, bruto e convertido, em um anel de
+  // nSlots amostras em memória compartilhada POSIX. Outros processos locais leem os
+  // dados com libOpcTrigaPLCShmReader (libOpcTrigaPLCShm.h), sem abrir sessões no PLC.
+  // Retorna 0 em caso de sucesso e 1 em caso de erro.
+  bool startShmPublisher(std::string name = PLC_SHM_DEFAULT_NAME, uint32_t nSlots = 1024);
+  void stopShmPublisher();
+
+  // Histórico em memória (libOpcTrigaPLCHistory.h) dos snapshots convertidos, das mesmas
+  // fontes do modo publicador, com consultas por intervalo de tempo e agregados por janela
+  // (ex.: mínimo, máximo e média de CLin nos últimos 10 minutos). O histórico retornado
+  // pode ser consultado de qualquer thread e continua válido após disableHistory().
+  std::shared_ptr<libOpcTrigaPLCHistory> enableHistory(size_t capacity = 65536);
+  void disableHistory();
+  std::shared_ptr<libOpcTrigaPLCHistory> getHistory(); // nullptr se desativado
+
 private:
   libOpcTrigaPLC_private *_p;
 
+  PLC_DATA readAll(PLC_MASK mask = PLC_MASK_ALL);
+  PLC_DATA staleData();
+  bool subscribe();
+  void connectionLoop();
+  void acquisitionLoop(ACQ_CONFIG config);
+  void watchLoop();
+  bool reloadConv(const std::string& filename);
+
   std::string stdErrorMsg(std::string functionName, std::string errorMsg,
                           std::string exptionMsg);
+  void publishSnapshot(const PLC_DATA& raw, const PLC_DATA& conv);
+  void reportError(PLC_ERROR_CODE code, const char* function, const char* message,
+                   uint32_t status = 0, int channel = -1, const char* detail = nullptr);
+
+  std::shared_ptr<const CONV_TABLE> convTable();
 
   float convLin(float  x, CONV_LIN conv);
   float convLog(double x, CONV_LOG conv);
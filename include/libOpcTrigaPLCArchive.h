@@ -0,0 +1,115 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <libOpcTrigaPLCRecorder.h>
+#include <string>
+#include <vector>
+
+// Formato compactado para arquivamento de longo prazo de PLC_DATA brutos:
+//
+//   ARC_FILE_HEADER
+//   ARC_BLOCK_HEADER + bytes de dados codificados
+//   ARC_BLOCK_HEADER + bytes de dados codificados
+//   ...
+//
+// Cada bloco tem até blockCapacity amostras e é decodificado de forma independente,
+// permitindo acesso aleatório por índice ou tempo. Dentro do bloco a primeira amostra
+// é gravada completa e as demais em um fluxo de bits, no estilo Gorilla:
+//   TIME:         delta-of-delta, com zigzag, em faixas de 0, 12, 24, 32 ou 64 bits
+//   MASK e STATE: 1 bit se iguais aos da amostra anterior
+//   canais:       diferença do valor bruto int16 para a amostra anterior do mesmo canal,
+//                 com zigzag, em faixas de 0, 4, 8 ou 17 bits
+// Canais parados custam 1 bit por amostra. Cada bloco leva um CRC-32 do seu cabeçalho
+// e dos seus dados, conferido antes da decodificação.
+
+struct ARC_FILE_HEADER
+{
+  char     magic[8];      // "TRIGAARC"
+  uint32_t version;
+  uint32_t nChannels;     // PLC_N_CHANNELS
+  uint32_t blockCapacity;
+  uint32_t reserved;
+  CONV_PLC fatorConv;     // Fatores de conversão em uso durante a gravação
+};
+
+struct ARC_BLOCK_HEADER
+{
+  char     magic[4];      // "ABLK"
+  uint32_t count;         // Amostras no bloco
+  int64_t  firstTime;     // PLC_RECORD::time da primeira e da última amostra
+  int64_t  lastTime;
+  uint32_t bytes;         // Tamanho dos dados codificados que seguem
+  uint32_t crc;           // CRC-32 do cabeçalho (com crc = 0) e dos dados
+};
+
+// Codificação de um bloco em memória: archiveEncode() substitui o conteúdo de out;
+// archiveDecode() decodifica n amostras e retorna 0 em caso de sucesso e 1 se os dados
+// estão truncados ou corrompidos.
+void archiveEncode(const PLC_RECORD* records, size_t n, std::vector<uint8_t>& out);
+bool archiveDecode(const uint8_t* data, size_t bytes, size_t n, PLC_RECORD* out);
+
+struct libOpcTrigaPLCArchiveWriter_private;
+
+// Grava um fluxo de PLC_DATA brutos em arquivo compactado
+class libOpcTrigaPLCArchiveWriter {
+public:
+  libOpcTrigaPLCArchiveWriter(std::string filename, const CONV_PLC& fatorConv, uint32_t blockCapacity = 4096);
+  ~libOpcTrigaPLCArchiveWriter();
+
+  bool isOpen() const;
+  bool append(const PLC_DATA& raw); // Retorna 0 em caso de sucesso e 1 em caso de erro
+  bool flush();                     // Grava o bloco em andamento (mesmo incompleto)
+  uint64_t size() const;            // Amostras gravadas
+  uint64_t bytes() const;           // Bytes gravados no arquivo
+
+private:
+  libOpcTrigaPLCArchiveWriter_private *_p;
+};
+
+struct libOpcTrigaPLCArchiveReader_private;
+
+// Leitura de um arquivo compactado via mmap. Apenas o bloco acessado é decodificado.
+class libOpcTrigaPLCArchiveReader {
+public:
+  libOpcTrigaPLCArchiveReader(std::string filename);
+  ~libOpcTrigaPLCArchiveReader();
+
+  bool isOpen() const;
+  CONV_PLC fatorConv() const;
+  size_t size() const;        // Total de amostras
+  size_t blockCount() const;
+
+  // Amostra i, decodificando o bloco que a contém se necessário; get() a converte em
+  // PLC_DATA bruto (para convAllData()). Retornam 0 em caso de sucesso e 1 se i está
+  // fora do arquivo ou seu bloco está corrompido (relatado apenas na primeira vez).
+  bool record(size_t i, PLC_RECORD& rec);
+  bool get(size_t i, PLC_DATA& raw);
+
+  // Índice da primeira amostra com TIME >= t. Retorna size() se não houver, ou se o
+  // bloco que a conteria está corrompido.
+  size_t lowerBound(std::chrono::system_clock::time_point t);
+
+  // Decodifica o bloco b inteiro em out. Retorna 0 em caso de sucesso e 1 em caso de erro.
+  bool readBlock(size_t b, std::vector<PLC_RECORD>& out) const;
+
+private:
+  libOpcTrigaPLCArchiveReader_private *_p;
+};
@@ -0,0 +1,71 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <libOpcTrigaPLC.h>
+#include <vector>
+
+// Histórico em memória de snapshots PLC_DATA, com capacidade fixa (anel).
+// Os valores são guardados em colunas, uma por canal, e os tempos em uma coluna
+// ordenada, de modo que intervalos de tempo são localizados por busca binária.
+// Agregados por janela usam resumos de blocos de amostras organizados em uma árvore
+// de segmentos: O(log n) mais as amostras avulsas nas bordas da janela.
+// Pode ser usado de várias threads (um escritor e qualquer número de leitores).
+
+// Agregados de um canal em uma janela de tempo. Consideram apenas amostras válidas
+// (canal atualizado, com StatusCode utilizável (plcStatusUsable()), em snapshot não STALE).
+struct PLC_AGGREGATE
+{
+  uint64_t count = 0;
+  float    min   = 0;
+  float    max   = 0;
+  double   mean  = 0;
+  float    last  = 0; // Amostra válida mais recente da janela
+  std::chrono::system_clock::time_point lastTime;
+};
+
+struct libOpcTrigaPLCHistory_private;
+
+class libOpcTrigaPLCHistory {
+public:
+  libOpcTrigaPLCHistory(size_t capacity); // Arredondada para múltiplo do tamanho de bloco
+  ~libOpcTrigaPLCHistory();
+
+  // Acrescenta um snapshot, sobrescrevendo o mais antigo se cheio. Tempos devem ser
+  // crescentes; um TIME anterior ao último (ex.: ajuste do relógio) é gravado como o último.
+  void append(const PLC_DATA& data);
+  void clear();
+
+  size_t capacity() const;
+  size_t size() const;
+  std::chrono::system_clock::time_point firstTime() const;
+  std::chrono::system_clock::time_point lastTime() const;
+
+  // Agregados do canal ch na janela [t0, t1)
+  PLC_AGGREGATE aggregate(int ch, std::chrono::system_clock::time_point t0,
+                          std::chrono::system_clock::time_point t1) const;
+
+  // Amostras válidas do canal ch na janela [t0, t1). Retorna o número de amostras.
+  size_t series(int ch, std::chrono::system_clock::time_point t0, std::chrono::system_clock::time_point t1,
+                std::vector<std::chrono::system_clock::time_point>& times, std::vector<float>& values) const;
+
+private:
+  libOpcTrigaPLCHistory_private *_p;
+};
@@ -0,0 +1,95 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <libOpcTrigaPLC.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include <chrono>
+
+// Aquisição de vários PLCs (ex.: mesas de controle e PLCs auxiliares) por uma única
+// thread. Cada PLC tem sua própria sessão OPC UA, e a thread envia a requisição Read
+// de todas as sessões no início do ciclo, sem esperar as respostas, e então processa as
+// respostas na ordem em que chegam, esperando nos sockets das sessões (sem varredura
+// ativa) até todas responderem ou chegar o prazo do próximo ciclo. A duração de um ciclo é,
+// assim, a latência do PLC mais lento e não a soma das latências.
+
+// Snapshot de um PLC, identificado pelo índice retornado por addPlc()
+struct PLC_TAGGED_DATA
+{
+  size_t   plc   = 0;
+  uint64_t cycle = 0;  // Ciclo do gerenciador em que a leitura foi enviada
+  PLC_DATA_EX data;    // Dados brutos com a temporização da leitura (ver get_all_ex())
+};
+
+// Parâmetros do gerenciador, ver libOpcTrigaPLCManager::start()
+struct MANAGER_CONFIG
+{
+  std::chrono::nanoseconds period{std::chrono::milliseconds(100)};
+  RECONNECT_CONFIG reconnect;                         // Espera entre tentativas de conexão de cada PLC e timeouts
+  std::chrono::milliseconds pollSlice{1};             // Com várias sessões aguardando resposta, espera máxima em
+                                                      // cada uma antes de passar à seguinte
+  size_t queueSize = 1024;                            // Snapshots retidos na fila; os mais antigos são descartados
+  std::function<void(const PLC_TAGGED_DATA&)> callback; // Chamado na thread do gerenciador a cada snapshot
+};
+
+struct libOpcTrigaPLCManager_private;
+
+class libOpcTrigaPLCManager {
+public:
+  libOpcTrigaPLCManager();
+  ~libOpcTrigaPLCManager();
+
+  // Acrescenta um PLC, com os canais de mask, e retorna seu índice.
+  // address como no construtor de libOpcTrigaPLC, ex.: "192.168.0.1:4840".
+  // Os PLCs devem ser acrescentados antes de start(); com o gerenciador ativo retorna size_t(-1).
+  size_t addPlc(std::string name, std::string address, PLC_MASK mask = PLC_MASK_ALL);
+  size_t size() const;
+  const std::string& name(size_t plc) const;
+  PLC_CONN_STATE getConnState(size_t plc) const;
+
+  // Inicia a thread do gerenciador, que conecta (e reconecta, com espera exponencial e
+  // jitter por PLC, ver RECONNECT_CONFIG) cada PLC e lê todos a cada período. Ciclos em que um PLC ainda não respondeu à leitura anterior não enviam nova
+  // leitura a ele. Retorna 0 em caso de sucesso e 1 se já estava ativo ou não há PLCs.
+  bool start(MANAGER_CONFIG config = {});
+  void stop();
+  bool isRunning() const;
+
+  // Fila única de snapshots de todos os PLCs, na ordem de chegada.
+  // pop() espera até timeout por um snapshot e retorna 0 em caso de sucesso e 1 se a
+  // fila continuou vazia; popAll() acrescenta a out todos os snapshots disponíveis e
+  // retorna quantos foram acrescentados.
+  bool pop(PLC_TAGGED_DATA& data, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+  size_t popAll(std::vector<PLC_TAGGED_DATA>& out);
+  uint64_t dropped() const; // Snapshots descartados por fila cheia
+
+  // Destino dos erros, como em libOpcTrigaPLC::setErrorSink(); PLC_ERROR::detail é o
+  // nome do PLC e PLC_ERROR::function a etapa da thread do gerenciador em que o erro
+  // ocorreu: "sessionStart()" (conexão ou envio da leitura), "sessionIterate()" (sessão
+  // perdida) ou "onRead()" (resposta da leitura com erro).
+  // Sem callback, os erros são escritos em std::cerr a cada mudança de estado.
+  void setErrorSink(std::function<void(const PLC_ERROR&)> sink);
+
+private:
+  libOpcTrigaPLCManager_private *_p;
+
+  void loop();
+};
@@ -0,0 +1,114 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <libOpcTrigaPLC.h>
+#include <string>
+
+// Formato binário de gravação de PLC_DATA brutos:
+//
+//   REC_FILE_HEADER
+//   REC_CHUNK_HEADER + PLC_RECORD[count]
+//   REC_CHUNK_HEADER + PLC_RECORD[count]
+//   ...
+//
+// Cada chunk tem até chunkCapacity amostras (o último pode ser menor) e guarda o
+// intervalo de tempo que contém, permitindo localizar amostras por tempo sem ler o
+// arquivo todo. Os valores são gravados na ordem de bytes da máquina.
+
+// Uma amostra gravada: valores brutos (int16) de cada canal, no índice PLC_CHANNEL
+struct PLC_RECORD
+{
+  int64_t  time;                 // PLC_DATA::TIME em ns desde a época Unix
+  PLC_MASK mask;                 // PLC_DATA::MASK
+  int16_t  state;                // PLC_DATA::STATE
+  int16_t  raw[PLC_N_CHANNELS];  // Valores brutos
+  int16_t  reserved;
+};
+
+struct REC_FILE_HEADER
+{
+  char     magic[8];      // "TRIGAREC"
+  uint32_t version;
+  uint32_t nChannels;     // PLC_N_CHANNELS
+  uint32_t recordSize;    // sizeof(PLC_RECORD)
+  uint32_t chunkCapacity;
+  CONV_PLC fatorConv;     // Fatores de conversão em uso durante a gravação
+};
+
+struct REC_CHUNK_HEADER
+{
+  char     magic[4];      // "CHNK"
+  uint32_t count;         // Amostras neste chunk
+  int64_t  firstTime;     // Menor e maior PLC_RECORD::time do chunk
+  int64_t  lastTime;
+};
+
+PLC_RECORD plcToRecord(const PLC_DATA& raw);
+PLC_DATA   recordToPlc(const PLC_RECORD& rec);
+
+struct libOpcTrigaPLCRecorder_private;
+
+// Grava um fluxo de PLC_DATA brutos (ex.: retornados por get_all()) em arquivo.
+// Erros (ERR_FILE) vão para errorSink, como em libOpcTrigaPLC::setErrorSink(), com o nome
+// do arquivo em PLC_ERROR::detail; sem destino são escritos em std::cerr.
+class libOpcTrigaPLCRecorder {
+public:
+  libOpcTrigaPLCRecorder(std::string filename, const CONV_PLC& fatorConv, uint32_t chunkCapacity = 4096,
+                         std::function<void(const PLC_ERROR&)> errorSink = nullptr);
+  ~libOpcTrigaPLCRecorder();
+
+  bool isOpen() const;
+  bool append(const PLC_DATA& raw); // Retorna 0 em caso de sucesso e 1 em caso de erro
+  bool flush();                     // Grava o chunk em andamento (mesmo incompleto)
+  uint64_t size() const;            // Amostras gravadas
+  void setErrorSink(std::function<void(const PLC_ERROR&)> sink);
+
+private:
+  libOpcTrigaPLCRecorder_private *_p;
+};
+
+struct libOpcTrigaPLCReplay_private;
+
+// Leitura de uma gravação via mmap: acesso direto às amostras do arquivo, sem cópia.
+// Erros ao abrir o arquivo vão para errorSink, como em libOpcTrigaPLCRecorder.
+class libOpcTrigaPLCReplay {
+public:
+  libOpcTrigaPLCReplay(std::string filename, std::function<void(const PLC_ERROR&)> errorSink = nullptr);
+  ~libOpcTrigaPLCReplay();
+
+  bool isOpen() const;
+  CONV_PLC fatorConv() const;            // Fatores embutidos na gravação
+  size_t size() const;                   // Total de amostras
+  const PLC_RECORD& operator[](size_t i) const;
+  PLC_DATA get(size_t i) const;          // Amostra i como PLC_DATA bruto (para convAllData())
+
+  // Índice da primeira amostra com TIME >= t (size() se não houver)
+  size_t lowerBound(std::chrono::system_clock::time_point t) const;
+
+  // Copia os valores brutos do canal ch das amostras [begin, end) para out (ex.: para convBlock())
+  void column(int ch, size_t begin, size_t end, int16_t* out) const;
+
+  // Amostras contíguas em memória: o chunk que contém a amostra i, de i até o fim do chunk
+  const PLC_RECORD* span(size_t i, size_t& count) const;
+
+private:
+  libOpcTrigaPLCReplay_private *_p;
+};
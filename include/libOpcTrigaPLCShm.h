@@ -0,0 +1,65 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <libOpcTrigaPLC.h>
+#include <string>
+
+// Leitura dos snapshots publicados em memória compartilhada por outro processo,
+// ver libOpcTrigaPLC::startShmPublisher(). Um único processo mantém a sessão OPC UA
+// com o PLC e qualquer número de processos locais lê os dados sem acesso à rede.
+
+struct libOpcTrigaPLCShmReader_private;
+
+class libOpcTrigaPLCShmReader {
+public:
+  libOpcTrigaPLCShmReader(std::string name = PLC_SHM_DEFAULT_NAME);
+  ~libOpcTrigaPLCShmReader();
+
+  // Se o segmento ainda não existe, ou o publicador foi encerrado ou reiniciado,
+  // as leituras tentam anexar novamente ao segmento de mesmo nome.
+  bool isOpen() const;
+
+  // Último snapshot publicado, com a mesma interface de libOpcTrigaPLC. Sem publicador
+  // ativo, ou com o publicador parado no meio de uma publicação, retorna o último
+  // snapshot conhecido com STALE = true e STATE = 2. Nunca espera pelo publicador.
+  PLC_DATA get_all();
+  PLC_DATA get_all_conv();
+
+  // O publicador é considerado inativo se seu processo terminou sem fechar o segmento
+  // ou, com aquisição em segundo plano, se não publica há mais de periods períodos
+  // da aquisição (0 desativa essa verificação). Padrão: 5.
+  void setStalePeriods(uint32_t periods);
+
+  // Acesso sequencial, para leitores que não podem perder amostras: sequence() é o
+  // número da última amostra publicada (1 = primeira) e get() lê a amostra seq, se
+  // ela ainda está no anel. Retorna 0 em caso de sucesso e 1 se já foi sobrescrita
+  // ou ainda não foi publicada.
+  uint64_t sequence();
+  bool get(uint64_t seq, PLC_DATA& raw, PLC_DATA& conv);
+
+  CONV_PLC fatorConv(); // Fatores de conversão em uso pelo publicador
+
+private:
+  libOpcTrigaPLCShmReader_private *_p;
+
+  bool attach();
+  void update();
+};
@@ -0,0 +1,132 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "allocCounter.h"
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <new>
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+extern "C" void* __libc_valloc(size_t size);
+extern "C" void* __libc_pvalloc(size_t size);
+extern "C" void  __libc_free(void* ptr);
+
+static std::atomic<uint64_t> nAllocs{0};
+
+uint64_t allocCount()
+{
+    return nAllocs.load(std::memory_order_relaxed);
+}
+
+static void count()
+{
+    nAllocs.fetch_add(1, std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------- Família malloc
+
+extern "C" void* malloc(size_t size)
+{
+    count();
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size)
+{
+    count();
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+    count();
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size)
+{
+    count();
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size)
+{
+    count();
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+    count();
+    void* p = __libc_memalign(alignment, size);
+    if (!p) return ENOMEM;
+    *ptr = p;
+    return 0;
+}
+
+extern "C" void* valloc(size_t size)
+{
+    count();
+    return __libc_valloc(size);
+}
+
+extern "C" void* pvalloc(size_t size)
+{
+    count();
+    return __libc_pvalloc(size);
+}
+
+//-------------------------------------------------------------------- operator new/delete
+
+//Vão direto ao alocador da glibc, para não contar de novo pelas funções acima
+static void* allocate(size_t size, size_t alignment, bool nothrow)
+{
+    count();
+    if (size == 0) size = 1;
+    void* p = alignment > alignof(std::max_align_t) ? __libc_memalign(alignment, size) : __libc_malloc(size);
+    if (!p && !nothrow) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size)                                         { return allocate(size, 0, false); }
+void* operator new[](size_t size)                                       { return allocate(size, 0, false); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept         { return allocate(size, 0, true); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept       { return allocate(size, 0, true); }
+void* operator new(size_t size, std::align_val_t al)                    { return allocate(size, size_t(al), false); }
+void* operator new[](size_t size, std::align_val_t al)                  { return allocate(size, size_t(al), false); }
+void* operator new(size_t size, std::align_val_t al, const std::nothrow_t&) noexcept   { return allocate(size, size_t(al), true); }
+void* operator new[](size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return allocate(size, size_t(al), true); }
+
+void operator delete(void* ptr) noexcept                                { __libc_free(ptr); }
+void operator delete[](void* ptr) noexcept                              { __libc_free(ptr); }
+void operator delete(void* ptr, size_t) noexcept                        { __libc_free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept                      { __libc_free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept              { __libc_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept            { __libc_free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept      { __libc_free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept    { __libc_free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept         { __libc_free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept       { __libc_free(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept   { __libc_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { __libc_free(ptr); }
@@ -0,0 +1,29 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+//Contagem de alocações do programa inteiro (inclusive open62541 e libstdc++), para o
+//benchmark e os testes. O programa que a usa deve ligar allocCounter.cpp, que substitui
+//operator new (todas as variantes, inclusive alinhadas) e a família malloc (malloc,
+//calloc, realloc, aligned_alloc, posix_memalign, memalign, valloc e pvalloc).
+//Cada alocação é contada uma única vez. Específico da glibc.
+uint64_t allocCount();
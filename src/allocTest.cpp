@@ -0,0 +1,156 @@
+/*
+This is an allocation test for libOpcTrigaPLC, a library to communicate with
+the Triga PLC using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Verifica que o caminho de aquisição em regime não aloca memória: inicia o
+// opctrigaplc-simulator, conecta e conta as alocações (allocCounter.cpp) de get_all(),
+// convAllData() e convBlock(). A decodificação da resposta Read pela open62541 aloca por
+// si só; ela é medida com uma requisição Read equivalente feita direto pelo cliente, e
+// get_all() não pode alocar nada além dela. Retorna 0 se passou e 1 se falhou.
+
+#include <libOpcTrigaPLC.h>
+#include <open62541pp/open62541pp.h>
+#include "allocCounter.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static const int N_CALLS = 1000;
+
+static pid_t startSimulator(const char* simulator, const char* port)
+{
+    const pid_t pid = fork();
+    if (pid == 0)
+    {
+        const int null = open("/dev/null", O_WRONLY);
+        if (null >= 0) dup2(null, STDOUT_FILENO);
+        execl(simulator, simulator, "--port", port, "--update", "10", (char*)nullptr);
+        _exit(127);
+    }
+    return pid;
+}
+
+static bool check(bool ok, const std::string& name, const std::string& detail)
+{
+    std::cout << (ok ? "PASS " : "FAIL ") << name << ": " << detail << std::endl;
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <simulator> <port>" << std::endl;
+        return 1;
+    }
+    const pid_t simulator = startSimulator(argv[1], argv[2]);
+    if (simulator < 0) return 1;
+    const std::string address = std::string("localhost:") + argv[2];
+
+    bool ok = true;
+    bool simulatorRunning = true;
+    {
+        libOpcTrigaPLC plc(address);
+        plc.setErrorSink([](const PLC_ERROR&) {}); //Falhas de conexão esperadas até o simulador subir
+        PLC_DATA data = plc.get_all();
+        const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (data.STATE != 0 && std::chrono::steady_clock::now() < timeout)
+        {
+            if (waitpid(simulator, nullptr, WNOHANG) == simulator)
+            {
+                simulatorRunning = false;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (plc.getConnState() != CONN_CONNECTED) plc.tryConnect();
+            data = plc.get_all();
+        }
+        plc.setErrorSink(nullptr);
+        ok = check(data.STATE == 0, "connect", "STATE " + std::to_string(data.STATE));
+
+        if (ok)
+        {
+            //Referência: a mesma requisição Read, direto pelo cliente
+            opcua::Client client;
+            UA_Client_connect(client.handle(), ("opc.tcp://" + address).c_str());
+            std::vector<opcua::ReadValueId> ids;
+            for (const PLC_CHANNEL_INFO& c : PLC_CHANNELS) ids.emplace_back(opcua::NodeId(2, c.nodeId), opcua::AttributeId::Value);
+            const opcua::ReadRequest request(opcua::RequestHeader{}, 0, opcua::TimestampsToReturn::Both, ids);
+
+            //Aquecimento, depois as duas leituras intercaladas sob as mesmas condições
+            for (int i = 0; i < 10; i++)
+            {
+                plc.get_all();
+                opcua::services::read(client, request);
+            }
+            uint64_t libAllocs = 0, refAllocs = 0, errors = 0;
+            for (int i = 0; i < N_CALLS; i++)
+            {
+                uint64_t a0 = allocCount();
+                data = plc.get_all();
+                libAllocs += allocCount() - a0;
+                if (data.STATE != 0) errors++;
+
+                a0 = allocCount();
+                opcua::services::read(client, request);
+                refAllocs += allocCount() - a0;
+            }
+            ok &= check(errors == 0, "get_all() reads", std::to_string(errors) + " errors");
+            ok &= check(libAllocs <= refAllocs, "get_all() allocations",
+                        std::to_string(double(libAllocs) / N_CALLS) + " per call, open62541 Read alone " +
+                        std::to_string(double(refAllocs) / N_CALLS));
+            UA_Client_disconnect(client.handle());
+        }
+
+        plc.convAllData(data);
+        uint64_t a0 = allocCount();
+        float sum = 0;
+        for (int i = 0; i < N_CALLS; i++) sum += plc.convAllData(data).CLin;
+        const uint64_t convAllocs = allocCount() - a0;
+        ok &= check(convAllocs == 0, "convAllData() allocations", std::to_string(convAllocs) + " in " + std::to_string(N_CALLS) + " calls");
+
+        std::vector<int16_t> raw(256, 2000);
+        std::vector<float> conv[PLC_N_CHANNELS];
+        PLC_BLOCK_RAW rawBlock;
+        PLC_BLOCK_CONV convBlock;
+        rawBlock.n = raw.size();
+        for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+        {
+            conv[ch].resize(raw.size());
+            rawBlock.col[ch]  = raw.data();
+            convBlock.col[ch] = conv[ch].data();
+        }
+        plc.convBlock(rawBlock, convBlock);
+        a0 = allocCount();
+        for (int i = 0; i < N_CALLS; i++) plc.convBlock(rawBlock, convBlock);
+        const uint64_t blockAllocs = allocCount() - a0;
+        ok &= check(blockAllocs == 0, "convBlock() allocations", std::to_string(blockAllocs) + " in " + std::to_string(N_CALLS) + " calls");
+        if (sum == 1234.5f) std::cerr << ""; //Evita que o laço seja descartado
+    }
+
+    if (simulatorRunning)
+    {
+        kill(simulator, SIGTERM);
+        waitpid(simulator, nullptr, 0);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,257 @@
+/*
+This is a benchmark program for libOpcTrigaPLC, a library to communicate with 
+the Triga PLC using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Mede a latência de get_all() (contra o PLC ou o opctrigaplc-simulator), a vazão de
+// convAllData()/convBlock(), o tempo de readFatorConvFile() e a vazão e a taxa de
+// compressão do arquivo compactado, além das alocações por chamada. Cada resultado é
+// uma linha JSON em stdout, para comparar versões.
+
+#include <libOpcTrigaPLC.h>
+#include <libOpcTrigaPLCArchive.h>
+#include "latencyHistogram.h"
+#include "allocCounter.h"
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+
+using benchClock = std::chrono::steady_clock;
+
+static uint64_t elapsedNs(benchClock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(benchClock::now() - start).count();
+}
+
+static void printHistogram(const std::string& name, const LatencyHistogram& hist, uint64_t allocs, uint64_t errors = 0)
+{
+    std::cout << "{\"benchmark\":\"" << name << "\""
+              << ",\"samples\":"   << hist.count()
+              << ",\"mean_ns\":"   << (uint64_t)hist.mean()
+              << ",\"p50_ns\":"    << hist.percentile(0.50)
+              << ",\"p99_ns\":"    << hist.percentile(0.99)
+              << ",\"p999_ns\":"   << hist.percentile(0.999)
+              << ",\"max_ns\":"    << hist.max()
+              << ",\"allocs_per_call\":" << (double)allocs / std::max<uint64_t>(hist.count(), 1)
+              << ",\"errors\":"   << errors
+              << "}" << std::endl;
+}
+
+static void printThroughput(const std::string& name, uint64_t samples, uint64_t ns, uint64_t allocs, uint64_t calls, uint64_t errors = 0)
+{
+    std::cout << "{\"benchmark\":\"" << name << "\""
+              << ",\"samples\":"         << samples
+              << ",\"samples_per_s\":"   << (uint64_t)(samples * 1e9 / std::max<uint64_t>(ns, 1))
+              << ",\"allocs_per_call\":" << (double)allocs / std::max<uint64_t>(calls, 1)
+              << ",\"errors\":"          << errors
+              << "}" << std::endl;
+}
+
+//Amostra bruta aleatória com valores na faixa típica do PLC
+static PLC_DATA randomRaw(std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> dist(0, 8191);
+    PLC_DATA raw;
+    for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+    {
+        if (PLC_CHANNELS[ch].rawType == RAW_SCALE_BITS) raw.CLinScale = dist(rng) % 8;
+        else                                            plcField(raw, ch) = dist(rng);
+    }
+    return raw;
+}
+
+static void benchGetAll(const std::string& address, const std::string& filename, int iterations)
+{
+    libOpcTrigaPLC plc(address, filename);
+    for (int i = 0; i < 10; i++) plc.get_all(); //Aquecimento
+
+    static LatencyHistogram hist;
+    uint64_t errors = 0;
+    const uint64_t allocs0 = allocCount();
+    for (int i = 0; i < iterations; i++)
+    {
+        const auto start = benchClock::now();
+        const PLC_DATA data = plc.get_all();
+        hist.record(elapsedNs(start));
+        if (data.STATE != 0) errors++;
+    }
+    printHistogram("get_all", hist, allocCount() - allocs0, errors);
+}
+
+static void benchConvAllData(const std::string& filename, int iterations)
+{
+    libOpcTrigaPLC plc(CONV_PLC{});
+    plc.readFatorConvFile(filename);
+    std::mt19937 rng(1);
+    std::vector<PLC_DATA> samples(4096);
+    for (PLC_DATA& s : samples) s = randomRaw(rng);
+    plc.convAllData(samples[0]); //Aquecimento
+
+    float sink = 0;
+    const uint64_t allocs0 = allocCount();
+    const auto start = benchClock::now();
+    for (int i = 0; i < iterations; i++)
+        sink += plc.convAllData(samples[i % samples.size()]).CLin;
+    const uint64_t ns = elapsedNs(start);
+    printThroughput("convAllData", iterations, ns, allocCount() - allocs0, iterations);
+    if (sink == 1234.5f) std::cerr << ""; //Evita que o laço seja descartado
+}
+
+static void benchConvBlock(const std::string& filename, int iterations)
+{
+    libOpcTrigaPLC plc(CONV_PLC{});
+    plc.readFatorConvFile(filename);
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> dist(0, 8191);
+    const size_t n = 4096;
+    std::vector<int16_t> raw[PLC_N_CHANNELS];
+    std::vector<float> conv[PLC_N_CHANNELS];
+    PLC_BLOCK_RAW rawBlock;
+    PLC_BLOCK_CONV convBlock;
+    rawBlock.n = n;
+    for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+    {
+        raw[ch].resize(n);
+        conv[ch].resize(n);
+        for (int16_t& x : raw[ch]) x = dist(rng);
+        rawBlock.col[ch]  = raw[ch].data();
+        convBlock.col[ch] = conv[ch].data();
+    }
+    plc.convBlock(rawBlock, convBlock);
+
+    const int blocks = std::max<int>(iterations / n, 1);
+    const uint64_t allocs0 = allocCount();
+    const auto start = benchClock::now();
+    for (int i = 0; i < blocks; i++) plc.convBlock(rawBlock, convBlock);
+    const uint64_t ns = elapsedNs(start);
+    printThroughput("convBlock", (uint64_t)blocks * n, ns, allocCount() - allocs0, blocks);
+}
+
+static void benchReadFatorConvFile(const std::string& filename, int runs)
+{
+    libOpcTrigaPLC plc(CONV_PLC{});
+    static LatencyHistogram hist;
+    const uint64_t allocs0 = allocCount();
+    for (int i = 0; i < runs; i++)
+    {
+        const auto start = benchClock::now();
+        plc.readFatorConvFile(filename);
+        hist.record(elapsedNs(start));
+    }
+    printHistogram("readFatorConvFile", hist, allocCount() - allocs0);
+}
+
+//Amostras no estilo do opctrigaplc-simulator (--wave sine --wave-period 600 --update 100):
+//senoides lentas com ruído de poucos LSB, a cada 100 ms com jitter de dezenas de µs
+static std::vector<PLC_RECORD> simulatedRecords(size_t n)
+{
+    std::mt19937 rng(1);
+    std::normal_distribution<double> noise(0, 1.5);
+    std::normal_distribution<double> jitter(0, 30000);
+    std::vector<PLC_RECORD> records(n);
+    int64_t time = 1700000000000000000;
+    for (size_t i = 0; i < n; i++)
+    {
+        PLC_RECORD& rec = records[i];
+        const double t = i * 0.1;
+        rec.time  = time + (int64_t)jitter(rng);
+        rec.mask  = PLC_MASK_ALL;
+        rec.state = 0;
+        for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+        {
+            if (PLC_CHANNELS[ch].rawType == RAW_SCALE_BITS) rec.raw[ch] = (int)(t / 600) % 8;
+            else rec.raw[ch] = std::lround(4000 + 2000 * std::sin(2 * M_PI * (t / 600 + double(ch) / double(PLC_N_CHANNELS))) + noise(rng));
+        }
+        time += 100000000;
+    }
+    return records;
+}
+
+static void benchArchive(const std::vector<PLC_RECORD>& records, const std::string& source, int runs)
+{
+    const size_t blockSize = 4096;
+    std::vector<uint8_t> encoded;
+    std::vector<PLC_RECORD> decoded(blockSize);
+    uint64_t bytes = 0;
+    uint64_t encodeNs = 0;
+    uint64_t decodeNs = 0;
+    uint64_t errors = 0;
+    const uint64_t allocs0 = allocCount();
+    for (int run = 0; run < runs; run++)
+    {
+        for (size_t i = 0; i < records.size(); i += blockSize)
+        {
+            const size_t n = std::min(blockSize, records.size() - i);
+            auto start = benchClock::now();
+            archiveEncode(&records[i], n, encoded);
+            encodeNs += elapsedNs(start);
+            if (run == 0) bytes += sizeof(ARC_BLOCK_HEADER) + encoded.size();
+
+            start = benchClock::now();
+            errors += archiveDecode(encoded.data(), encoded.size(), n, decoded.data());
+            decodeNs += elapsedNs(start);
+            if (std::memcmp(decoded.data(), &records[i], n * sizeof(PLC_RECORD)) != 0) errors++;
+        }
+    }
+    const uint64_t allocs = allocCount() - allocs0;
+    const uint64_t samples = records.size() * runs;
+    const uint64_t calls   = (records.size() + blockSize - 1) / blockSize * runs;
+
+    std::cout << "{\"benchmark\":\"archive\""
+              << ",\"source\":\""             << source << "\""
+              << ",\"samples\":"               << samples
+              << ",\"encode_samples_per_s\":"  << (uint64_t)(samples * 1e9 / std::max<uint64_t>(encodeNs, 1))
+              << ",\"decode_samples_per_s\":"  << (uint64_t)(samples * 1e9 / std::max<uint64_t>(decodeNs, 1))
+              << ",\"bytes_per_sample\":"      << (double)bytes / std::max<size_t>(records.size(), 1)
+              << ",\"ratio_vs_recorder\":"     << (double)records.size() * sizeof(PLC_RECORD) / std::max<uint64_t>(bytes, 1)
+              << ",\"allocs_per_call\":"       << (double)allocs / std::max<uint64_t>(calls, 1)
+              << ",\"errors\":"                << errors
+              << "}" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4 && argc != 5)
+    {
+        std::cerr << "Usage: " << argv[0] << " <address|-> <filename> <iterations> [recording]" << std::endl;
+        std::cerr << "       address '-' skips the get_all() benchmark (no server needed)" << std::endl;
+        std::cerr << "       recording: libOpcTrigaPLCRecorder file used by the archive benchmark" << std::endl;
+        std::cerr << "                  (default: simulated sine waves)" << std::endl;
+        return 1;
+    }
+    const std::string address  = argv[1];
+    const std::string filename = argv[2];
+    const int iterations = std::stoi(argv[3]);
+
+    if (address != "-") benchGetAll(address, filename, iterations);
+    benchConvAllData(filename, iterations * 100);
+    benchConvBlock(filename, iterations * 100);
+    benchReadFatorConvFile(filename, std::max(iterations / 100, 10));
+
+    if (argc == 5)
+    {
+        libOpcTrigaPLCReplay replay(argv[4]);
+        std::vector<PLC_RECORD> records(replay.size());
+        for (size_t i = 0; i < replay.size(); i++) records[i] = replay[i];
+        benchArchive(records, argv[4], std::max(iterations / 100, 1));
+    }
+    else benchArchive(simulatedRecords(100000), "simulated", std::max(iterations / 100, 1));
+    return 0;
+}
@@ -0,0 +1,47 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <libOpcTrigaPLC.h>
+#include <string>
+#include <functional>
+
+//Mensagem de erro no formato de libOpcTrigaPLC::stdErrorMsg(), para as demais classes da biblioteca
+inline std::string plcErrorMsg(const std::string& className, const std::string& functionName,
+                               const std::string& errorMsg, const std::string& codeMsg = "")
+{
+    std::string msg = "ERROR in " + className + "::" + functionName + "\n\tError type: " + errorMsg;
+    if (codeMsg != "") msg += "\n\tError code: " + codeMsg;
+    return msg + "\n";
+}
+
+//Entrega um erro ao destino opcional (ver libOpcTrigaPLC::setErrorSink()) ou, sem destino,
+//o escreve em std::cerr. detail (ex.: nome do arquivo) pode ser vazio.
+inline void plcReportError(const std::function<void(const PLC_ERROR&)>& sink, const std::string& className,
+                           PLC_ERROR_CODE code, const char* function, const char* message,
+                           const std::string& detail = "")
+{
+    if (sink)
+    {
+        sink(PLC_ERROR{code, function, message, detail.empty() ? nullptr : detail.c_str()});
+        return;
+    }
+    std::cerr << plcErrorMsg(className, function, detail.empty() ? message : std::string(message) + ": " + detail);
+}
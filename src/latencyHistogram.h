@@ -0,0 +1,107 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <bit>
+
+//Histograma de latências no estilo HDR: faixas log-lineares, cada potência de 2 dividida
+//em 2^(SUB_BITS-1) partes, com erro relativo máximo de ~3% em qualquer escala (ns a horas).
+//record() é um único incremento atômico relaxado e pode ser chamado de qualquer thread.
+class LatencyHistogram
+{
+public:
+    static constexpr int SUB_BITS  = 6;
+    static constexpr int HALF      = 1 << (SUB_BITS - 1);
+    static constexpr int N_BUCKETS = (64 - SUB_BITS + 1) * HALF + HALF;
+
+    LatencyHistogram()
+    {
+        reset();
+    }
+
+    void record(uint64_t value)
+    {
+        buckets_[index(value)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+        uint64_t max = max_.load(std::memory_order_relaxed);
+        while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+    }
+
+    void reset()
+    {
+        for (auto& b : buckets_) b.store(0, std::memory_order_relaxed);
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum()   const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t max()   const { return max_.load(std::memory_order_relaxed); }
+    double   mean()  const { return count() ? (double)sum() / count() : 0; }
+
+    //Valor abaixo do qual estão a fração p (0 a 1) das amostras (limite superior da faixa)
+    uint64_t percentile(double p) const
+    {
+        const uint64_t total = count();
+        if (total == 0) return 0;
+        uint64_t target = (uint64_t)(p * total);
+        if (target >= total) target = total - 1;
+
+        uint64_t seen = 0;
+        for (int i = 0; i < N_BUCKETS; i++)
+        {
+            seen += buckets_[i].load(std::memory_order_relaxed);
+            if (seen > target) return std::min(upperBound(i), max());
+        }
+        return max();
+    }
+
+    //Acesso às faixas, para exportação (ex.: formato Prometheus)
+    uint64_t bucketCount(int i) const { return buckets_[i].load(std::memory_order_relaxed); }
+
+    static int index(uint64_t value)
+    {
+        if (value < 2 * HALF) return (int)value;
+        const int shift = std::bit_width(value) - SUB_BITS;
+        return (shift << (SUB_BITS - 1)) + (int)(value >> shift);
+    }
+
+    static uint64_t lowerBound(int i)
+    {
+        if (i < 2 * HALF) return i;
+        const int shift = (i >> (SUB_BITS - 1)) - 1;
+        return (uint64_t)(i - (shift << (SUB_BITS - 1))) << shift;
+    }
+
+    static uint64_t upperBound(int i)
+    {
+        return (i + 1 < N_BUCKETS) ? lowerBound(i + 1) - 1 : UINT64_MAX;
+    }
+
+private:
+    std::atomic<uint64_t> buckets_[N_BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
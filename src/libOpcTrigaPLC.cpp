@@ -18,17 +18,223 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include <libOpcTrigaPLC.h>
+#include "seqSlot.h"
+#include "latencyHistogram.h"
+#include "shmRing.h"
+#include "plcChannelData.h"
+#include <libOpcTrigaPLCHistory.h>
 #include <cmath>
 #include <open62541pp/open62541pp.h>
 #include <fstream>
+#include <vector>
+#include <optional>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <climits>
+#include <mutex>
+#include <condition_variable>
+#include <random>
+#include <cstring>
+#include <ctime>
+#include <cerrno>
+#include <cstdio>
+#include <algorithm>
+#include <filesystem>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sched.h>
 
+//Contadores e histogramas de getStats(). Todos atômicos e relaxados: cada ponto instrumentado
+//custa alguns fetch_add, e apenas uma leitura de enabled se as estatísticas estão desativadas.
+struct PLC_STATS_COUNTERS
+{
+    static constexpr int N_STATUS = 32; //Tabela de StatusCodes distintos (endereçamento aberto)
+
+    std::atomic<bool> enabled{false};
+    std::atomic<uint64_t> connectAttempts{0};
+    std::atomic<uint64_t> connectFailures{0};
+    std::atomic<uint64_t> disconnects{0};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> readErrors{0};
+    std::atomic<uint64_t> channelErrors[PLC_N_CHANNELS] = {};
+    std::atomic<uint32_t> statusCode[N_STATUS] = {};  //0 (Good) marca posição livre
+    std::atomic<uint64_t> statusCount[N_STATUS] = {};
+    std::atomic<uint64_t> statusOther{0};             //StatusCodes que não couberam na tabela
+    LatencyHistogram readTime;
+    LatencyHistogram cycleTime;
+    LatencyHistogram convTime;
+
+    bool on() const { return enabled.load(std::memory_order_relaxed); }
+
+    void addStatus(uint32_t code)
+    {
+        for (int i = 0, slot = code % N_STATUS; i < N_STATUS; i++, slot = (slot + 1) % N_STATUS)
+        {
+            uint32_t current = statusCode[slot].load(std::memory_order_relaxed);
+            if (current == 0 && statusCode[slot].compare_exchange_strong(current, code, std::memory_order_relaxed))
+                current = code;
+            if (current == code)
+            {
+                statusCount[slot].fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        statusOther.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void reset()
+    {
+        connectAttempts = 0;
+        connectFailures = 0;
+        disconnects     = 0;
+        reads           = 0;
+        readErrors      = 0;
+        statusOther     = 0;
+        for (auto& c : channelErrors) c = 0;
+        for (auto& c : statusCount)   c = 0;
+        for (auto& c : statusCode)    c = 0;
+        readTime.reset();
+        cycleTime.reset();
+        convTime.reset();
+    }
+};
+
+//Mede a duração de um trecho e registra em um histograma, se as estatísticas estão ativas
+class StatsTimer
+{
+public:
+    StatsTimer(const PLC_STATS_COUNTERS& stats, LatencyHistogram& hist)
+        : hist_(stats.on() ? &hist : nullptr)
+    {
+        if (hist_) start_ = std::chrono::steady_clock::now();
+    }
+    ~StatsTimer()
+    {
+        if (hist_) hist_->record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+    }
+
+private:
+    LatencyHistogram* hist_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+//Erro já relatado pelo destino padrão, para deduplicação
+struct ERROR_ENTRY
+{
+    bool used = false;
+    PLC_ERROR_CODE code;
+    const char* function;
+    uint32_t status;
+    int channel;
+    std::chrono::steady_clock::time_point lastReport;
+    uint64_t suppressed = 0;
+};
+
+struct CONV_TABLE;
+static std::shared_ptr<const CONV_TABLE> compileConv(const CONV_PLC& f);
 
 struct libOpcTrigaPLC_private {
     opcua::Client client;
+    std::recursive_mutex clientMutex; //Serializa o uso do cliente entre as threads
     PLC_DATA plcData;
     std::string serverAddress;
+
+    //Modo subscription (recriada a cada reconexão enquanto subActive)
+    std::optional<opcua::Subscription<opcua::Client>> subscription;
+    std::atomic<bool> subActive{false};
+    SUB_CONFIG subConfig;
+    std::function<void(const PLC_DATA&)> subCallback;
+    bool subPending = false; //Notificações aplicadas a plcData e ainda não publicadas
+
+    //Reconexão automática
+    std::thread connThread;
+    std::atomic<bool> connRunning{false};
+    std::atomic<PLC_CONN_STATE> connState{CONN_DISCONNECTED};
+    RECONNECT_CONFIG reconnConfig;
+    std::mutex connWaitMutex;
+    std::condition_variable connWait;
+
+    //Aquisição em segundo plano
+    std::thread acqThread;
+    std::atomic<bool> acqRunning{false};
+    SeqSlot<PLC_DATA> latestRaw;
+    SeqSlot<PLC_DATA> latestConv;
+    SeqSlot<PLC_CYCLE> latestCycle;
+    SeqSlot<PLC_DATA_EX> latestEx;
+
+    //Temporização de plcData (ver get_all_ex()), atualizada junto com os canais
+    std::array<PLC_CHANNEL_TIME, PLC_N_CHANNELS> plcTime{};
+    std::chrono::steady_clock::time_point plcSent;
+    std::chrono::steady_clock::time_point plcReceived;
+
+    //NodeIds dos canais, resolvidos uma vez na conexão, e requisição Read pré-montada
+    std::vector<opcua::NodeId> nodeIds;
+    std::vector<opcua::ReadValueId> readValueIds;
+    std::optional<opcua::ReadRequest> readRequest;
+    PLC_MASK readMask = 0; //Canais incluídos em readRequest
+
+    //Fatores de conversão compilados (ver compileConv()), trocados atomicamente a cada recarga
+    std::atomic<std::shared_ptr<const CONV_TABLE>> convTable;
+    std::mutex convFileMutex;
+    std::string convFile; //Último arquivo lido por readFatorConvFile()
+
+    //Bandas mortas do arquivo de conversão e filtro de get_changes()
+    std::atomic<std::shared_ptr<const PLC_DEADBANDS>> deadbands{std::make_shared<const PLC_DEADBANDS>()};
+    std::mutex changeMutex;
+    libOpcTrigaPLCChangeFilter changeFilter;
+
+    //Recarga automática do arquivo de conversão (ver watchFatorConvFile())
+    std::thread watchThread;
+    std::atomic<bool> watchRunning{false};
+    int watchFd = -1;
+    std::string watchFile;
+
+    //Estatísticas de execução (ver enableStats())
+    PLC_STATS_COUNTERS stats;
+
+    //Destino de erros (ver setErrorSink()); sem callback, erros repetidos são limitados por errorInterval
+    std::mutex errorMutex;
+    std::function<void(const PLC_ERROR&)> errorSink;
+    std::chrono::milliseconds errorInterval{10000};
+    ERROR_ENTRY errorEntries[32];
+
+    //Modo publicador em memória compartilhada (ver startShmPublisher())
+    std::atomic<bool> shmActive{false};
+    std::mutex shmMutex; //Serializa as publicações (get_all_conv() e threads internas)
+    std::unique_ptr<ShmRing> shm;
+    CONV_PLC shmConv;    //Fatores já gravados no segmento
+    std::chrono::nanoseconds acqPeriod{0}; //Período anunciado aos leitores, 0 sem aquisição periódica
+
+    //Histórico em memória dos snapshots convertidos (ver enableHistory())
+    std::atomic<bool> historyActive{false};
+    std::atomic<std::shared_ptr<libOpcTrigaPLCHistory>> history;
 };
 
+//Registra a perda da conexão e acorda a thread de reconexão
+static void setDisconnected(libOpcTrigaPLC_private* p)
+{
+    if (p->connState.exchange(CONN_DISCONNECTED) == CONN_CONNECTED && p->stats.on())
+        p->stats.disconnects.fetch_add(1, std::memory_order_relaxed);
+    p->connWait.notify_all();
+}
+
+//Publica plcData, com sua temporização, como o último snapshot bruto
+static void storeLatest(libOpcTrigaPLC_private* p)
+{
+    p->latestRaw.store(p->plcData);
+
+    PLC_DATA_EX ex;
+    ex.data     = p->plcData;
+    ex.time     = p->plcTime;
+    ex.sent     = p->plcSent;
+    ex.received = p->plcReceived;
+    ex.rtt      = p->plcReceived - p->plcSent;
+    p->latestEx.store(ex);
+}
+
 void libOpcTrigaPLC_license()
 {
     std::cout << "libOpcTrigaPLC    Copyright (C) 2024 Thalles Campagnani" << std::endl;
@@ -38,17 +244,68 @@ void libOpcTrigaPLC_license()
     std::cout << "that came together with the library." << std::endl << std::endl;
 }
 
-bool libOpcTrigaPLC::tryConnect()
+//Resolve os NodeIds de todos os canais, usados nas requisições Read e na subscription.
+//Se conectado, registra os nós no servidor (serviço RegisterNodes), que pode devolver
+//identificadores otimizados para acessos repetidos; caso contrário usa os NodeIds string.
+static void resolveChannels(libOpcTrigaPLC_private* p)
 {
-    try
+    p->nodeIds.clear();
+    for (const PLC_CHANNEL_INFO& c : PLC_CHANNELS)
+        p->nodeIds.emplace_back(2, c.nodeId);
+
+    if (p->client.isConnected())
     {
-        this->_p->client.connect(this->_p->serverAddress);
+        std::vector<UA_NodeId> toRegister;
+        for (const opcua::NodeId& id : p->nodeIds) toRegister.push_back(*id.handle());
+
+        UA_RegisterNodesRequest request;
+        UA_RegisterNodesRequest_init(&request);
+        request.nodesToRegister     = toRegister.data();
+        request.nodesToRegisterSize = toRegister.size();
+        UA_RegisterNodesResponse response = UA_Client_Service_registerNodes(p->client.handle(), request);
+        if (response.responseHeader.serviceResult == UA_STATUSCODE_GOOD &&
+            response.registeredNodeIdsSize == PLC_N_CHANNELS)
+        {
+            for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+                p->nodeIds[ch] = opcua::NodeId(response.registeredNodeIds[ch]);
+        }
+        UA_RegisterNodesResponse_clear(&response);
     }
-    catch (const std::exception& e)
+
+    p->readRequest.reset();
+}
+
+//Monta a requisição Read dos canais de mask. É mantida até a máscara mudar.
+static void buildReadRequest(libOpcTrigaPLC_private* p, PLC_MASK mask)
+{
+    if (p->nodeIds.empty()) resolveChannels(p);
+
+    p->readValueIds.clear();
+    for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+        if (mask & (PLC_MASK(1) << ch)) p->readValueIds.emplace_back(p->nodeIds[ch], opcua::AttributeId::Value);
+    p->readRequest.emplace(opcua::RequestHeader{}, 0, opcua::TimestampsToReturn::Both, p->readValueIds);
+    p->readMask = mask;
+}
+
+bool libOpcTrigaPLC::tryConnect()
+{
+    std::lock_guard<std::recursive_mutex> lock(this->_p->clientMutex);
+    if (this->_p->stats.on()) this->_p->stats.connectAttempts.fetch_add(1, std::memory_order_relaxed);
+    this->_p->connState = CONN_CONNECTING;
+    if (this->_p->client.isConnected()) UA_Client_disconnect(this->_p->client.handle());
+    const UA_StatusCode status = UA_Client_connect(this->_p->client.handle(), this->_p->serverAddress.c_str());
+    if (status != UA_STATUSCODE_GOOD)
     {
-        std::cerr << stdErrorMsg("tryConnect()", "Erro ao tentar conectar", e.what());
+        this->_p->connState = CONN_DISCONNECTED;
+        if (this->_p->stats.on()) this->_p->stats.connectFailures.fetch_add(1, std::memory_order_relaxed);
+        reportError(ERR_CONNECT, "tryConnect()", "Erro ao tentar conectar", status);
         return 1;
     }
+    //Nova sessão: NodeIds registrados e subscriptions da sessão anterior não valem mais
+    this->_p->subscription.reset();
+    resolveChannels(this->_p);
+    if (this->_p->subActive) subscribe();
+    this->_p->connState = CONN_CONNECTED;
     return 0;
 }
 
@@ -67,10 +324,79 @@ std::string libOpcTrigaPLC::stdErrorMsg(std::string functionName, std::string er
     return msg;
 }
 
+void libOpcTrigaPLC::setErrorSink(std::function<void(const PLC_ERROR&)> sink)
+{
+    std::lock_guard<std::mutex> lock(this->_p->errorMutex);
+    this->_p->errorSink = std::move(sink);
+}
+
+void libOpcTrigaPLC::setErrorRateLimit(std::chrono::milliseconds interval)
+{
+    std::lock_guard<std::mutex> lock(this->_p->errorMutex);
+    this->_p->errorInterval = interval;
+}
+
+//Entrega um erro ao destino configurado. Até decidir se o erro será escrito nada é alocado,
+//de modo que uma falha repetida a cada leitura custa apenas uma busca na tabela de erros.
+void libOpcTrigaPLC::reportError(PLC_ERROR_CODE code, const char* function, const char* message,
+                                 uint32_t status, int channel, const char* detail)
+{
+    PLC_ERROR error{code, function, message, detail, status, channel};
+    std::lock_guard<std::mutex> lock(this->_p->errorMutex);
+    if (this->_p->errorSink)
+    {
+        this->_p->errorSink(error);
+        return;
+    }
+
+    //Procura o erro na tabela; um erro novo ocupa uma entrada livre ou a relatada há mais tempo
+    const auto now = std::chrono::steady_clock::now();
+    ERROR_ENTRY* entry  = nullptr;
+    ERROR_ENTRY* oldest = &this->_p->errorEntries[0];
+    for (ERROR_ENTRY& e : this->_p->errorEntries)
+    {
+        if (!e.used)
+        {
+            if (oldest->used) oldest = &e;
+            continue;
+        }
+        if (e.code == code && e.status == status && e.channel == channel && std::strcmp(e.function, function) == 0)
+        {
+            entry = &e;
+            break;
+        }
+        if (oldest->used && e.lastReport < oldest->lastReport) oldest = &e;
+    }
+
+    if (entry && now - entry->lastReport < this->_p->errorInterval)
+    {
+        entry->suppressed++;
+        return;
+    }
+    if (!entry)
+    {
+        entry = oldest;
+        *entry = ERROR_ENTRY{true, code, function, status, channel, now, 0};
+    }
+    error.suppressed  = entry->suppressed;
+    entry->suppressed = 0;
+    entry->lastReport = now;
+
+    std::string type = message;
+    if (channel >= 0) type += std::string(" (canal ") + PLC_CHANNELS[channel].name + ")";
+    std::string codeMsg;
+    if (status != UA_STATUSCODE_GOOD) codeMsg = UA_StatusCode_name(status);
+    if (detail) codeMsg += (codeMsg.empty() ? "" : " - ") + std::string(detail);
+    std::string msg = stdErrorMsg(function, type, codeMsg);
+    if (error.suppressed) msg += "\tRepeated: " + std::to_string(error.suppressed) + " times since last report\n";
+    std::cerr << msg;
+}
+
 libOpcTrigaPLC::libOpcTrigaPLC(std::string address)
 {
     this->_p = new libOpcTrigaPLC_private;
     this->_p->serverAddress = "opc.tcp://" + address;
+    this->_p->convTable.store(compileConv(CONV_PLC{}), std::memory_order_release);
     tryConnect();
 }
 
@@ -79,31 +405,44 @@ libOpcTrigaPLC::libOpcTrigaPLC(std::string address, std::string filename)
     this->_p = new libOpcTrigaPLC_private;
     this->_p->serverAddress = "opc.tcp://" + address;
     tryConnect();
-    this->fatorConv = this->readFatorConvFile(filename);
+    this->readFatorConvFile(filename); //Publica os fatores lidos
+    if (!this->_p->convTable.load(std::memory_order_acquire))
+        this->_p->convTable.store(compileConv(CONV_PLC{}), std::memory_order_release);
+}
+
+libOpcTrigaPLC::libOpcTrigaPLC(CONV_PLC fatorConv)
+{
+    this->_p = new libOpcTrigaPLC_private;
+    this->_p->convTable.store(compileConv(fatorConv), std::memory_order_release);
 }
 
 libOpcTrigaPLC::~libOpcTrigaPLC()
 {
+    disableAutoReconnect();
+    stopAcquisition();
+    stopSubscription();
+    stopShmPublisher();
+    unwatchFatorConvFile();
     this->_p->client.disconnect();
     delete this->_p;
 }
 
 //Função para converter o valor de x através de 2 pontos conhecidos. 
-float libOpcTrigaPLC::convLin(float x, CONV_LIN conv)
+static float convLinValue(float x, const CONV_LIN& conv)
 {
     if (x==-1) return x;
     return x * (conv.y1-conv.y0) / (conv.x1-conv.x0) + (conv.y0*conv.x1-conv.y1*conv.x0) / (conv.x1-conv.x0);
 }
 
 //Função para converter o valor de x, sendo x logarítimo de base 10. 
-float libOpcTrigaPLC::convLog(double x, CONV_LOG conv)
+static float convLogValue(double x, const CONV_LOG& conv)
 {
     if (x==-1) return x;
     return conv.A*std::pow(10,conv.B*x);
 }
 
 //Função para converter o valor de x, sendo x sinal de período. 
-float libOpcTrigaPLC::convPer(double x, CONV_PER conv)
+static float convPerValue(double x, const CONV_PER& conv)
 {
     if (x==-1) return x;
     double dom = x-conv.K;
@@ -111,95 +450,842 @@ float libOpcTrigaPLC::convPer(double x, CONV_PER conv)
     return conv.L/dom;
 }
 
+float libOpcTrigaPLC::convLin(float x, CONV_LIN conv)
+{
+    return convLinValue(x, conv);
+}
+
+float libOpcTrigaPLC::convLog(double x, CONV_LOG conv)
+{
+    return convLogValue(x, conv);
+}
+
+float libOpcTrigaPLC::convPer(double x, CONV_PER conv)
+{
+    return convPerValue(x, conv);
+}
+
+//Conversão compilada de um canal
+struct CONV_CHANNEL
+{
+    PLC_CONV_KIND kind = CONV_KIND_NONE;
+    float a = 1;                //LIN: y = a*x + b
+    float b = 0;
+    CONV_LOG log;               //LOG: fatores originais, para valores fora da tabela
+    CONV_PER per;               //PER: idem
+    const float* lut = nullptr; //LOG/PER: valor convertido de cada int16, indexado por x - INT16_MIN
+};
+
+//Fatores de conversão compilados a partir de um CONV_PLC: canais lineares viram coeficientes
+//afins e canais log/período viram tabelas de 65536 entradas, uma por valor bruto int16.
+//É imutável depois de criada, podendo ser compartilhada entre threads.
+struct CONV_TABLE
+{
+    CONV_PLC source;
+    CONV_CHANNEL ch[PLC_N_CHANNELS];
+    std::vector<float> lutData;
+};
+
+static constexpr size_t LUT_SIZE = 65536;
+
+static std::shared_ptr<const CONV_TABLE> compileConv(const CONV_PLC& f)
+{
+    auto table = std::make_shared<CONV_TABLE>();
+    table->source = f;
+    for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+    {
+        const PLC_CHANNEL_INFO& info = PLC_CHANNELS[ch];
+        const char* factors = reinterpret_cast<const char*>(&f) + info.convOffset;
+        CONV_CHANNEL& c = table->ch[ch];
+        c.kind = info.convKind;
+        if (c.kind == CONV_KIND_LIN)
+        {
+            const CONV_LIN& conv = *reinterpret_cast<const CONV_LIN*>(factors);
+            c.a = (conv.y1-conv.y0) / (conv.x1-conv.x0);
+            c.b = (conv.y0*conv.x1-conv.y1*conv.x0) / (conv.x1-conv.x0);
+        }
+        else if (c.kind == CONV_KIND_LOG) c.log = *reinterpret_cast<const CONV_LOG*>(factors);
+        else if (c.kind == CONV_KIND_PER) c.per = *reinterpret_cast<const CONV_PER*>(factors);
+    }
+
+    size_t nLut = 0;
+    for (const CONV_CHANNEL& conv : table->ch)
+        if (conv.kind == CONV_KIND_LOG || conv.kind == CONV_KIND_PER) nLut++;
+    table->lutData.resize(nLut * LUT_SIZE);
+
+    float* lut = table->lutData.data();
+    for (CONV_CHANNEL& conv : table->ch)
+    {
+        if (conv.kind != CONV_KIND_LOG && conv.kind != CONV_KIND_PER) continue;
+        for (size_t i = 0; i < LUT_SIZE; i++)
+        {
+            const double x = (int32_t)i + INT16_MIN;
+            lut[i] = (conv.kind == CONV_KIND_LOG) ? convLogValue(x, conv.log) : convPerValue(x, conv.per);
+        }
+        conv.lut = lut;
+        lut += LUT_SIZE;
+    }
+    return table;
+}
+
+//Converte um valor: uma consulta à tabela para valores brutos inteiros,
+//fórmula original para os demais (ex.: valores já convertidos ou interpolados)
+static inline float convert(const CONV_CHANNEL& conv, float x)
+{
+    if (conv.kind == CONV_KIND_NONE || x == -1) return x;
+    if (conv.kind == CONV_KIND_LIN) return conv.a * x + conv.b;
+    if (x >= INT16_MIN && x <= INT16_MAX)
+    {
+        const int32_t i = (int32_t)x;
+        if (i == x) return conv.lut[i - INT16_MIN];
+    }
+    return (conv.kind == CONV_KIND_LOG) ? convLogValue(x, conv.log) : convPerValue(x, conv.per);
+}
+
+//Tabela compilada em uso. Quem a obtém mantém uma referência e termina a conversão com ela,
+//mesmo que uma recarga publique outra tabela no meio (troca no estilo RCU).
+//Só os construtores, setFatorConv(), readFatorConvFile() e as recargas publicam tabelas:
+//o caminho de conversão nunca compila tabelas.
+std::shared_ptr<const CONV_TABLE> libOpcTrigaPLC::convTable()
+{
+    return this->_p->convTable.load(std::memory_order_acquire);
+}
+
+CONV_PLC libOpcTrigaPLC::getFatorConv()
+{
+    return convTable()->source;
+}
+
+void libOpcTrigaPLC::setFatorConv(const CONV_PLC& fatorConv)
+{
+    this->_p->convTable.store(compileConv(fatorConv), std::memory_order_release);
+}
+
 //Função para converter os dados brutos do PLC
 PLC_DATA libOpcTrigaPLC::convAllData(PLC_DATA plcOrig)
 {
-    PLC_DATA plcConv   = plcOrig;
-    plcConv.BarraReg   = convLin(plcOrig.BarraReg,   fatorConv.BarraReg);//Converter bits para "posições de barra"
-    plcConv.BarraCon   = convLin(plcOrig.BarraCon,   fatorConv.BarraCon);
-    plcConv.BarraSeg   = convLin(plcOrig.BarraSeg,   fatorConv.BarraSeg);
-    plcConv.CLogALin   = convLin(plcOrig.CLogALin,   fatorConv.CLogALin);//Converter bits para W
-    plcConv.CLogALog   = convLog(plcOrig.CLogALog,   fatorConv.CLogALog);
-    plcConv.CLogAPer   = convPer(plcOrig.CLogAPer,   fatorConv.CLogAPer);
-    plcConv.CParALin   = convLin(plcOrig.CParALin,   fatorConv.CParALin);
-    plcConv.CParALog   = convLog(plcOrig.CParALog,   fatorConv.CParALog);
-    plcConv.CParAPer   = convPer(plcOrig.CParAPer,   fatorConv.CParAPer);
-    plcConv.CLogARea   = convLin(plcOrig.CLogARea,   fatorConv.CLogARea);
-    plcConv.CLin       = convLin(plcOrig.CLin,       fatorConv.CLin);
-    plcConv.CPer       = convLin(plcOrig.CPer,       fatorConv.CPer);
-    plcConv.SRadAre    = convLog(plcOrig.SRadAre,    fatorConv.SRadAer);
-    plcConv.SRadEntPri = convLog(plcOrig.SRadEntPri, fatorConv.SRadEntPri);
-    plcConv.SRadPoc    = convLog(plcOrig.SRadPoc,    fatorConv.SRadPoc);
-    plcConv.SRadRes    = convLog(plcOrig.SRadRes,    fatorConv.SRadRes);
-    plcConv.SRadSaiSec = convLog(plcOrig.SRadSaiSec, fatorConv.SRadSaiSec);
-    plcConv.SRadAer    = convLog(plcOrig.SRadAer,    fatorConv.SRadAer);
-    plcConv.SVasPri    = convLin(plcOrig.SVasPri,    fatorConv.SVasPri);//Converter bits para m^3/h
+    return convAllData(plcOrig, PLC_MASK_ALL);
+}
+
+PLC_DATA libOpcTrigaPLC::convAllData(PLC_DATA plcOrig, PLC_MASK mask)
+{
+    StatsTimer timer(this->_p->stats, this->_p->stats.convTime);
+    const std::shared_ptr<const CONV_TABLE> table = convTable();
+    PLC_DATA plcConv = plcOrig;
+    for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+    {
+        if (!(mask & (PLC_MASK(1) << ch)) || PLC_CHANNELS[ch].convKind == CONV_KIND_NONE) continue;
+        plcField(plcConv, ch) = convert(table->ch[ch], plcField(plcOrig, ch));
+    }
     return plcConv;
 }
 
+//Conversão de uma coluna: laços simples, sem desvios, que o compilador vetoriza
+static void convertColumn(const CONV_CHANNEL& conv, const int16_t* __restrict x, float* __restrict y, size_t n)
+{
+    switch (conv.kind)
+    {
+    case CONV_KIND_NONE:
+        for (size_t i = 0; i < n; i++) y[i] = x[i];
+        break;
+    case CONV_KIND_LIN:
+    {
+        const float a = conv.a;
+        const float b = conv.b;
+        for (size_t i = 0; i < n; i++)
+        {
+            const float xf = x[i];
+            y[i] = (x[i] == -1) ? -1.0f : a * xf + b;
+        }
+        break;
+    }
+    case CONV_KIND_LOG:
+    case CONV_KIND_PER:
+    {
+        //A tabela já contém a fórmula log10/período avaliada para todo int16 (inclusive -1)
+        const float* __restrict lut = conv.lut - INT16_MIN;
+        for (size_t i = 0; i < n; i++) y[i] = lut[x[i]];
+        break;
+    }
+    }
+}
+
+//Converte um bloco de amostras em colunas, canal a canal
+void libOpcTrigaPLC::convBlock(const PLC_BLOCK_RAW& raw, PLC_BLOCK_CONV& conv)
+{
+    StatsTimer timer(this->_p->stats, this->_p->stats.convTime);
+    const std::shared_ptr<const CONV_TABLE> table = convTable();
+    for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+    {
+        if (!raw.col[ch] || !conv.col[ch]) continue;
+        convertColumn(table->ch[ch], raw.col[ch], conv.col[ch], raw.n);
+    }
+}
+
 PLC_DATA libOpcTrigaPLC::get_all_conv()
 {
-    this->_p->plcData = convAllData(get_all());
-    return this->_p->plcData;
+    return get_all_conv(PLC_MASK_ALL);
 }
 
 PLC_DATA libOpcTrigaPLC::get_all()
 {
-    try
+    return get_all(PLC_MASK_ALL);
+}
+
+PLC_DATA libOpcTrigaPLC::get_all_conv(PLC_MASK mask)
+{
+    if (isAcquiring()) return this->_p->latestConv.load();
+
+    //plcData guarda sempre os valores brutos (a subscription o atualiza canal a canal)
+    //Converte os canais presentes em raw: com subscription ativa get_all() ignora mask
+    const PLC_DATA raw = get_all(mask);
+    const PLC_DATA conv = convAllData(raw, raw.MASK);
+    //Com subscription cada lote de notificações já foi publicado por runIterate()
+    if (!this->_p->subActive)
     {
-        this->_p->plcData.BarraReg     = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inBarraReg (%IW5)"}     )  .readValueScalar<int16_t>();
-        this->_p->plcData.BarraCon     = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inBarraCon (%IW6)"}     )  .readValueScalar<int16_t>();
-        this->_p->plcData.BarraSeg     = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inBarraSeg (%IW7)"}     )  .readValueScalar<int16_t>();
-        this->_p->plcData.CLinScale    = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inModule_D0 (%IW0)"}    )  .readValueScalar<u_int16_t>() & 0b00000111 - 2;
-        this->_p->plcData.CLin         = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inCLin (%IW8)"}         )  .readValueScalar<int16_t>();
-        this->_p->plcData.CPer         = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inCPer (%IW13)"}        )  .readValueScalar<int16_t>();
-        this->_p->plcData.CLogARea     = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inCLogARea (%IW14)"}    )  .readValueScalar<int16_t>();
-        this->_p->plcData.CLogALin     = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inCLogALin (%IW15)"}    )  .readValueScalar<int16_t>();
-        this->_p->plcData.CLogALog     = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inCLogALog (%IW16)"}    )  .readValueScalar<int16_t>();
-        this->_p->plcData.CLogAPer     = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inCLogAPer (%IW17)"}    )  .readValueScalar<int16_t>();
-        this->_p->plcData.CParALin     = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inCParALin (%IW18)"}    )  .readValueScalar<int16_t>();
-        this->_p->plcData.CParALog     = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inCParALog (%IW19)"}    )  .readValueScalar<int16_t>();
-        this->_p->plcData.CParAPer     = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inCParAPer (%IW20)"}    )  .readValueScalar<int16_t>();
-        this->_p->plcData.SRadAre      = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inSRadAre (%IW25)"}     )  .readValueScalar<int16_t>();
-        this->_p->plcData.SRadEntPri   = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inSRadEntPri (%IW26)"}  )  .readValueScalar<int16_t>();
-        this->_p->plcData.SRadPoc      = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inSRadPoc (%IW27)"}     )  .readValueScalar<int16_t>();
-        this->_p->plcData.SRadRes      = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inSRadRes (%IW28)"}     )  .readValueScalar<int16_t>();
-        this->_p->plcData.SRadSaiSec   = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inSRadSaiSec (%IW29)"}  )  .readValueScalar<int16_t>();
-        this->_p->plcData.SRadAer      = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inSRadAer (%IW30)"}     )  .readValueScalar<int16_t>();
-        this->_p->plcData.SVasPri      = this->_p->client.getNode( {2, "IoConfig_Globals_Mapping.inSVasPri (%IW49)"}     )  .readValueScalar<int16_t>();
-        this->_p->plcData.STATE = 0;
+        this->_p->latestConv.store(conv); //readAll() já guardou o bruto em latestRaw
+        publishSnapshot(raw, conv);
     }
-    catch (const std::exception& e)
+    return conv;
+}
+
+//Com aquisição em segundo plano ou subscription ativa todos os canais já estão
+//sendo atualizados, e o snapshot completo é retornado independente de mask
+PLC_DATA libOpcTrigaPLC::get_all(PLC_MASK mask)
+{
+    if (isAcquiring()) return this->_p->latestRaw.load();
+    return readAll(mask);
+}
+
+PLC_DATA_EX libOpcTrigaPLC::get_all_ex()
+{
+    return get_all_ex(PLC_MASK_ALL);
+}
+
+PLC_DATA_EX libOpcTrigaPLC::get_all_ex(PLC_MASK mask)
+{
+    if (isAcquiring()) return this->_p->latestEx.load();
+
+    //readAll() publica o snapshot estendido; se retornou dados antigos (STALE), eles prevalecem
+    const PLC_DATA data = readAll(mask);
+    PLC_DATA_EX ex = this->_p->latestEx.load();
+    ex.data = data;
+    return ex;
+}
+
+PLC_DATA_EX libOpcTrigaPLC::get_latest_ex()
+{
+    return this->_p->latestEx.load();
+}
+
+//Últimos dados conhecidos, sem acessar o cliente
+PLC_DATA libOpcTrigaPLC::staleData()
+{
+    PLC_DATA data = this->_p->latestRaw.load();
+    data.STALE = true;
+    if (this->_p->connState != CONN_CONNECTED) data.STATE = 2;
+    return data;
+}
+
+PLC_DATA libOpcTrigaPLC::readAll(PLC_MASK mask)
+{
+    //Com reconexão automática a leitura nunca espera: se o servidor caiu ou o cliente está
+    //em uso (ex.: conectando), retorna os últimos dados conhecidos
+    std::unique_lock<std::recursive_mutex> lock(this->_p->clientMutex, std::defer_lock);
+    if (this->_p->connRunning)
+    {
+        if (this->_p->connState != CONN_CONNECTED || !lock.try_lock()) return staleData();
+    }
+    else lock.lock();
+
+    if (this->_p->subscription)
+    {
+        runIterate(0);
+        storeLatest(this->_p);
+        return this->_p->plcData;
+    }
+
+    //Todos os canais pedidos são lidos em uma única requisição Read, reutilizada enquanto a máscara não mudar.
+    //Falhas são tratadas pelo StatusCode da resposta, sem exceções.
+    if (!this->_p->readRequest || this->_p->readMask != mask) buildReadRequest(this->_p, mask);
+    PLC_STATS_COUNTERS& stats = this->_p->stats;
+    if (stats.on()) stats.reads.fetch_add(1, std::memory_order_relaxed);
+    this->_p->plcSent = std::chrono::steady_clock::now();
+    opcua::ReadResponse response = [&] {
+        StatsTimer timer(stats, stats.readTime);
+        return opcua::services::read(this->_p->client, *this->_p->readRequest);
+    }();
+    this->_p->plcReceived = std::chrono::steady_clock::now();
+
+    UA_StatusCode status = response.getResponseHeader().getServiceResult().get();
+    const auto results = response.getResults();
+    if (status == UA_STATUSCODE_GOOD && results.size() != this->_p->readValueIds.size()) status = UA_STATUSCODE_BADUNEXPECTEDERROR;
+
+    if (status == UA_STATUSCODE_GOOD)
     {
+        size_t i = 0;
+        for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+        {
+            if (!(mask & (PLC_MASK(1) << ch)))
+            {
+                clearChannel(this->_p->plcData, ch);
+                this->_p->plcTime[ch] = {};
+                continue;
+            }
+            this->_p->plcTime[ch] = channelTime(results[i]);
+            if (setChannel(this->_p->plcData, ch, results[i++])) continue;
+            if (stats.on())
+            {
+                stats.channelErrors[ch].fetch_add(1, std::memory_order_relaxed);
+                stats.addStatus(this->_p->plcData.STATUS[ch]);
+            }
+            reportError(ERR_CHANNEL, "get_all()", "Canal lido com erro", this->_p->plcData.STATUS[ch], ch);
+        }
+        this->_p->plcData.STATE = stateFromStatus(this->_p->plcData);
+        this->_p->plcData.STALE = false;
+    }
+    else
+    {
+        if (stats.on())
+        {
+            stats.readErrors.fetch_add(1, std::memory_order_relaxed);
+            stats.addStatus(status);
+        }
+        //Republica os últimos valores brutos publicados, não o conteúdo corrente de plcData
+        this->_p->plcData = this->_p->latestRaw.load();
+        this->_p->plcData.STALE = true;
         if (this->_p->client.isConnected())
         {
-            std::cerr << stdErrorMsg("get_all()", "Cliente conectado, porém erro ao adquirir dados", e.what());
+            reportError(ERR_READ, "get_all()", "Cliente conectado, porém erro ao adquirir dados", status);
             this->_p->plcData.STATE = 1;
         }
         else
         {
-            std::cerr << stdErrorMsg("get_all()", "Cliente desconectado", e.what());
+            reportError(ERR_DISCONNECTED, "get_all()", "Cliente desconectado", status);
             this->_p->plcData.STATE = 2;
+            setDisconnected(this->_p);
         }
+        this->_p->plcData.MASK = 0;
+        this->_p->plcTime.fill({});
     }
 
     this->_p->plcData.TIME = std::chrono::system_clock::now();
+    storeLatest(this->_p);
     return this->_p->plcData;
 }
 
-//CONV_LIN 
+bool libOpcTrigaPLC::startSubscription(SUB_CONFIG config, std::function<void(const PLC_DATA&)> callback)
+{
+    std::lock_guard<std::recursive_mutex> lock(this->_p->clientMutex);
+    stopSubscription();
+    this->_p->subActive   = true;
+    this->_p->subConfig   = config;
+    this->_p->subCallback = std::move(callback);
+    if (subscribe() == 0) return 0;
+
+    this->_p->subActive   = false;
+    this->_p->subCallback = nullptr;
+    return 1;
+}
 
-CONV_PLC libOpcTrigaPLC::readFatorConvFile(std::string filename)
+//Cria a subscription com a configuração guardada em subConfig
+bool libOpcTrigaPLC::subscribe()
 {
-    CONV_PLC fatorConv;
-    if (filename=="") return fatorConv;
+    try
+    {
+        opcua::SubscriptionParameters subParams{};
+        subParams.publishingInterval = this->_p->subConfig.publishingInterval;
+        auto sub = this->_p->client.createSubscription(subParams);
 
+        //Até a primeira notificação de cada canal
+        this->_p->plcData.STATUS.fill(UA_STATUSCODE_BADWAITINGFORINITIALDATA);
+        this->_p->plcData.MASK = 0;
+        if (this->_p->nodeIds.empty()) resolveChannels(this->_p);
+        for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+        {
+            opcua::MonitoringParameters monParams{};
+            monParams.samplingInterval = this->_p->subConfig.samplingInterval;
+            monParams.queueSize        = this->_p->subConfig.queueSize;
+            sub.subscribeDataChange(
+                this->_p->nodeIds[ch],
+                opcua::AttributeId::Value,
+                opcua::MonitoringMode::Reporting,
+                monParams,
+                [this, ch](uint32_t /*subId*/, uint32_t /*monId*/, const opcua::DataValue& dv)
+                {
+                    this->_p->plcTime[ch]  = channelTime(dv);
+                    this->_p->plcReceived  = std::chrono::steady_clock::now();
+                    this->_p->plcSent      = this->_p->plcReceived;
+                    if (!setChannel(this->_p->plcData, ch, dv))
+                    {
+                        if (this->_p->stats.on())
+                        {
+                            this->_p->stats.channelErrors[ch].fetch_add(1, std::memory_order_relaxed);
+                            this->_p->stats.addStatus(this->_p->plcData.STATUS[ch]);
+                        }
+                        reportError(ERR_CHANNEL, "runIterate()", "Canal recebido com erro", this->_p->plcData.STATUS[ch], ch);
+                    }
+                    this->_p->subPending = true; //Publicado uma vez por lote, em runIterate()
+                });
+        }
+        this->_p->subscription = std::move(sub);
+    }
+    catch (const std::exception& e)
+    {
+        const auto* bad = dynamic_cast<const opcua::BadStatus*>(&e);
+        reportError(ERR_SUBSCRIPTION, "startSubscription()", "Erro ao criar subscription", bad ? bad->code() : 0, -1, e.what());
+        return 1;
+    }
+    return 0;
+}
+
+void libOpcTrigaPLC::stopSubscription()
+{
+    std::lock_guard<std::recursive_mutex> lock(this->_p->clientMutex);
+    this->_p->subActive = false;
+    if (!this->_p->subscription) return;
+    try
+    {
+        this->_p->subscription->deleteSubscription();
+    }
+    catch (const std::exception&)
+    {
+        //Servidor já desconectado, a subscription deixou de existir
+    }
+    this->_p->subscription.reset();
+    this->_p->subCallback = nullptr;
+}
+
+bool libOpcTrigaPLC::runIterate(uint16_t timeoutMs)
+{
+    std::lock_guard<std::recursive_mutex> lock(this->_p->clientMutex);
+    const UA_StatusCode status = UA_Client_run_iterate(this->_p->client.handle(), timeoutMs);
+
+    //As notificações de uma mesma iteração (um lote por intervalo de publicação) geram
+    //um único snapshot: publicado e entregue ao callback uma vez, com todos os canais.
+    //Com aquisição em segundo plano quem publica é a thread de aquisição, a cada ciclo.
+    if (this->_p->subPending)
+    {
+        this->_p->subPending = false;
+        this->_p->plcData.STATE = stateFromStatus(this->_p->plcData);
+        this->_p->plcData.STALE = false;
+        this->_p->plcData.TIME  = std::chrono::system_clock::now();
+        storeLatest(this->_p);
+        if (!this->_p->acqRunning.load(std::memory_order_relaxed))
+        {
+            const PLC_DATA conv = convAllData(this->_p->plcData);
+            this->_p->latestConv.store(conv);
+            publishSnapshot(this->_p->plcData, conv);
+        }
+        if (this->_p->subCallback) this->_p->subCallback(this->_p->plcData);
+    }
+
+    if (status != UA_STATUSCODE_GOOD)
+    {
+        reportError(ERR_DISCONNECTED, "runIterate()", "Cliente desconectado", status);
+        this->_p->plcData.STATE = 2;
+        this->_p->plcData.STALE = true;
+        setDisconnected(this->_p);
+        return 1;
+    }
+    return 0;
+}
+
+bool libOpcTrigaPLC::enableAutoReconnect(RECONNECT_CONFIG config)
+{
+    if (this->_p->connRunning.exchange(true)) return 1;
+    {
+        std::lock_guard<std::recursive_mutex> lock(this->_p->clientMutex);
+        this->_p->reconnConfig = config;
+        UA_Client_getConfig(this->_p->client.handle())->timeout = config.timeoutMs;
+        if (!this->_p->client.isConnected()) this->_p->connState = CONN_DISCONNECTED;
+    }
+    this->_p->connThread = std::thread(&libOpcTrigaPLC::connectionLoop, this);
+    return 0;
+}
+
+void libOpcTrigaPLC::disableAutoReconnect()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->_p->connWaitMutex);
+        this->_p->connRunning = false;
+    }
+    this->_p->connWait.notify_all();
+    if (this->_p->connThread.joinable()) this->_p->connThread.join();
+}
+
+PLC_CONN_STATE libOpcTrigaPLC::getConnState() const
+{
+    return this->_p->connState;
+}
+
+//Laço da thread de reconexão
+void libOpcTrigaPLC::connectionLoop()
+{
+    const RECONNECT_CONFIG& config = this->_p->reconnConfig;
+    std::minstd_rand rng(std::random_device{}());
+    std::uniform_real_distribution<double> jitter(1 - config.jitter, 1 + config.jitter);
+    std::chrono::duration<double, std::milli> delay = config.initialDelay;
+
+    std::unique_lock<std::mutex> waitLock(this->_p->connWaitMutex);
+    while (this->_p->connRunning)
+    {
+        if (this->_p->connState == CONN_CONNECTED)
+        {
+            //Verifica a conexão periodicamente; leituras com falha acordam a thread antes
+            this->_p->connWait.wait_for(waitLock, std::chrono::milliseconds(500));
+            std::unique_lock<std::recursive_mutex> lock(this->_p->clientMutex, std::try_to_lock);
+            if (lock.owns_lock() && !this->_p->client.isConnected()) setDisconnected(this->_p);
+            continue;
+        }
+
+        waitLock.unlock();
+        const bool error = tryConnect();
+        waitLock.lock();
+        if (!error)
+        {
+            delay = config.initialDelay;
+            continue;
+        }
+
+        const auto wait = delay * jitter(rng);
+        this->_p->connWait.wait_for(waitLock, wait, [this] { return !this->_p->connRunning; });
+        delay = std::min<std::chrono::duration<double, std::milli>>(delay * config.multiplier, config.maxDelay);
+    }
+}
+
+bool libOpcTrigaPLC::startAcquisition(std::chrono::microseconds period)
+{
+    ACQ_CONFIG config;
+    config.period = period;
+    return startAcquisition(config);
+}
+
+bool libOpcTrigaPLC::startAcquisition(ACQ_CONFIG config)
+{
+    if (this->_p->acqRunning.exchange(true)) return 1;
+    {
+        std::lock_guard<std::mutex> lock(this->_p->shmMutex);
+        this->_p->acqPeriod = config.period;
+        if (this->_p->shm) this->_p->shm->setPeriod(config.period);
+    }
+    this->_p->acqThread = std::thread(&libOpcTrigaPLC::acquisitionLoop, this, std::move(config));
+    return 0;
+}
+
+void libOpcTrigaPLC::stopAcquisition()
+{
+    this->_p->acqRunning = false;
+    if (this->_p->acqThread.joinable()) this->_p->acqThread.join();
+    std::lock_guard<std::mutex> lock(this->_p->shmMutex);
+    this->_p->acqPeriod = std::chrono::nanoseconds(0);
+    if (this->_p->shm) this->_p->shm->setPeriod(this->_p->acqPeriod);
+}
+
+bool libOpcTrigaPLC::isAcquiring() const
+{
+    return this->_p->acqRunning.load(std::memory_order_acquire);
+}
+
+PLC_DATA libOpcTrigaPLC::get_latest()
+{
+    return this->_p->latestRaw.load();
+}
+
+PLC_DATA libOpcTrigaPLC::get_latest_conv()
+{
+    return this->_p->latestConv.load();
+}
+
+PLC_CYCLE libOpcTrigaPLC::get_latest_cycle()
+{
+    return this->_p->latestCycle.load();
+}
+
+bool libOpcTrigaPLC::startShmPublisher(std::string name, uint32_t nSlots)
+{
+    std::lock_guard<std::mutex> lock(this->_p->shmMutex);
+    if (this->_p->shm) return 1;
+    this->_p->shm.reset(ShmRing::create(name, nSlots));
+    if (!this->_p->shm)
+    {
+        reportError(ERR_FILE, "startShmPublisher()", "Erro ao criar memória compartilhada", 0, -1, std::strerror(errno));
+        return 1;
+    }
+    this->_p->shmConv = getFatorConv();
+    this->_p->shm->setFatorConv(this->_p->shmConv);
+    this->_p->shm->setPeriod(this->_p->acqPeriod);
+    this->_p->shmActive = true;
+    return 0;
+}
+
+void libOpcTrigaPLC::stopShmPublisher()
+{
+    std::lock_guard<std::mutex> lock(this->_p->shmMutex);
+    this->_p->shmActive = false;
+    if (!this->_p->shm) return;
+    this->_p->shm->close();
+    this->_p->shm.reset();
+}
+
+//Entrega um snapshot novo ao modo publicador e ao histórico, se ativos
+void libOpcTrigaPLC::publishSnapshot(const PLC_DATA& raw, const PLC_DATA& conv)
+{
+    if (this->_p->historyActive.load(std::memory_order_relaxed))
+    {
+        if (std::shared_ptr<libOpcTrigaPLCHistory> history = this->_p->history.load(std::memory_order_acquire))
+            history->append(conv);
+    }
+
+    if (!this->_p->shmActive.load(std::memory_order_relaxed)) return;
+    std::lock_guard<std::mutex> lock(this->_p->shmMutex);
+    if (!this->_p->shm) return;
+    const CONV_PLC fatorConv = getFatorConv();
+    if (!(this->_p->shmConv == fatorConv))
+    {
+        this->_p->shmConv = fatorConv;
+        this->_p->shm->setFatorConv(fatorConv);
+    }
+    this->_p->shm->publish(raw, conv);
+}
+
+std::shared_ptr<libOpcTrigaPLCHistory> libOpcTrigaPLC::enableHistory(size_t capacity)
+{
+    std::shared_ptr<libOpcTrigaPLCHistory> history = this->_p->history.load(std::memory_order_acquire);
+    if (!history || history->capacity() < capacity)
+    {
+        history = std::make_shared<libOpcTrigaPLCHistory>(capacity);
+        this->_p->history.store(history, std::memory_order_release);
+    }
+    this->_p->historyActive = true;
+    return history;
+}
+
+void libOpcTrigaPLC::disableHistory()
+{
+    this->_p->historyActive = false;
+    this->_p->history.store(nullptr, std::memory_order_release);
+}
+
+std::shared_ptr<libOpcTrigaPLCHistory> libOpcTrigaPLC::getHistory()
+{
+    return this->_p->history.load(std::memory_order_acquire);
+}
+
+void libOpcTrigaPLC::enableStats(bool enable)
+{
+    this->_p->stats.enabled.store(enable, std::memory_order_relaxed);
+}
+
+void libOpcTrigaPLC::resetStats()
+{
+    this->_p->stats.reset();
+}
+
+static PLC_STATS_HIST histSummary(const LatencyHistogram& hist)
+{
+    PLC_STATS_HIST h;
+    h.count = hist.count();
+    h.sum   = hist.sum();
+    h.mean  = hist.mean();
+    h.p50   = hist.percentile(0.5);
+    h.p90   = hist.percentile(0.9);
+    h.p99   = hist.percentile(0.99);
+    h.p999  = hist.percentile(0.999);
+    h.max   = hist.max();
+    return h;
+}
+
+PLC_STATS libOpcTrigaPLC::getStats() const
+{
+    const PLC_STATS_COUNTERS& c = this->_p->stats;
+    PLC_STATS stats;
+    stats.enabled         = c.on();
+    stats.connectAttempts = c.connectAttempts.load(std::memory_order_relaxed);
+    stats.connectFailures = c.connectFailures.load(std::memory_order_relaxed);
+    stats.disconnects     = c.disconnects.load(std::memory_order_relaxed);
+    stats.reads           = c.reads.load(std::memory_order_relaxed);
+    stats.readErrors      = c.readErrors.load(std::memory_order_relaxed);
+    for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+        stats.channelErrors[ch] = c.channelErrors[ch].load(std::memory_order_relaxed);
+    for (int i = 0; i < PLC_STATS_COUNTERS::N_STATUS; i++)
+    {
+        const uint32_t code = c.statusCode[i].load(std::memory_order_relaxed);
+        if (code != 0) stats.statusErrors.emplace_back(code, c.statusCount[i].load(std::memory_order_relaxed));
+    }
+    if (const uint64_t other = c.statusOther.load(std::memory_order_relaxed))
+        stats.statusErrors.emplace_back(0x80000000, other); //Bad genérico
+    std::sort(stats.statusErrors.begin(), stats.statusErrors.end());
+    stats.readTime  = histSummary(c.readTime);
+    stats.cycleTime = histSummary(c.cycleTime);
+    stats.convTime  = histSummary(c.convTime);
+    return stats;
+}
+
+//Histograma como summary do Prometheus, em segundos
+static void promSummary(std::ostream& out, const std::string& name, const std::string& help, const PLC_STATS_HIST& h)
+{
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " summary\n";
+    const std::pair<const char*, uint64_t> quantiles[] = {{"0.5", h.p50}, {"0.9", h.p90}, {"0.99", h.p99}, {"0.999", h.p999}};
+    for (const auto& [q, v] : quantiles)
+        out << name << "{quantile=\"" << q << "\"} " << v * 1e-9 << "\n";
+    out << name << "_sum " << h.sum * 1e-9 << "\n";
+    out << name << "_count " << h.count << "\n";
+}
+
+static void promCounter(std::ostream& out, const std::string& name, const std::string& help, uint64_t value)
+{
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " counter\n";
+    out << name << " " << value << "\n";
+}
+
+bool libOpcTrigaPLC::dumpStatsPrometheus(std::string filename)
+{
+    const PLC_STATS stats = getStats();
+
+    //Grava em um arquivo temporário e renomeia: quem lê o arquivo nunca vê um dump pela metade
+    const std::string tmpName = filename + ".tmp";
+    {
+        std::ofstream out(tmpName);
+        if (!out)
+        {
+            reportError(ERR_FILE, "dumpStatsPrometheus()", "Erro ao criar o arquivo", 0, -1, tmpName.c_str());
+            return 1;
+        }
+
+        promCounter(out, "libopctrigaplc_connect_attempts_total", "Tentativas de conexão com o servidor OPC UA", stats.connectAttempts);
+        promCounter(out, "libopctrigaplc_connect_failures_total", "Tentativas de conexão que falharam", stats.connectFailures);
+        promCounter(out, "libopctrigaplc_disconnects_total", "Perdas de conexão detectadas", stats.disconnects);
+        promCounter(out, "libopctrigaplc_reads_total", "Requisições Read enviadas", stats.reads);
+        promCounter(out, "libopctrigaplc_read_errors_total", "Requisições Read que falharam", stats.readErrors);
+
+        out << "# HELP libopctrigaplc_channel_errors_total Leituras de canal com StatusCode ruim\n";
+        out << "# TYPE libopctrigaplc_channel_errors_total counter\n";
+        for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+            out << "libopctrigaplc_channel_errors_total{channel=\"" << PLC_CHANNELS[ch].name << "\"} " << stats.channelErrors[ch] << "\n";
+
+        out << "# HELP libopctrigaplc_status_errors_total Erros por StatusCode OPC UA\n";
+        out << "# TYPE libopctrigaplc_status_errors_total counter\n";
+        for (const auto& [code, count] : stats.statusErrors)
+        {
+            char hex[11];
+            std::snprintf(hex, sizeof(hex), "0x%08X", code);
+            out << "libopctrigaplc_status_errors_total{status=\"" << UA_StatusCode_name(code)
+                << "\",code=\"" << hex << "\"} " << count << "\n";
+        }
+
+        promSummary(out, "libopctrigaplc_read_seconds", "Duração de cada requisição Read", stats.readTime);
+        promSummary(out, "libopctrigaplc_cycle_seconds", "Duração de cada ciclo da aquisição em segundo plano", stats.cycleTime);
+        promSummary(out, "libopctrigaplc_conversion_seconds", "Duração de cada conversão", stats.convTime);
+
+        out.flush();
+        if (!out)
+        {
+            reportError(ERR_FILE, "dumpStatsPrometheus()", "Erro ao gravar o arquivo", 0, -1, tmpName.c_str());
+            return 1;
+        }
+    }
+    if (std::rename(tmpName.c_str(), filename.c_str()) != 0)
+    {
+        reportError(ERR_FILE, "dumpStatsPrometheus()", "Erro ao renomear o arquivo temporário", 0, -1, std::strerror(errno));
+        return 1;
+    }
+    return 0;
+}
+
+//Laço da thread de aquisição: único ponto que acessa o cliente OPC enquanto ativa
+void libOpcTrigaPLC::acquisitionLoop(ACQ_CONFIG config)
+{
+    if (config.cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(config.cpu, &cpus);
+        const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (error) reportError(ERR_THREAD, "startAcquisition()", "Erro ao fixar a thread na CPU", 0, -1, std::strerror(error));
+    }
+    if (config.rtPriority > 0)
+    {
+        sched_param param{};
+        param.sched_priority = config.rtPriority;
+        const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (error) reportError(ERR_THREAD, "startAcquisition()", "Erro ao definir prioridade de tempo real", 0, -1, std::strerror(error));
+    }
+
+    using clock = std::chrono::steady_clock;
+    const clock::duration period = std::chrono::duration_cast<clock::duration>(config.period);
+    PLC_CYCLE cycle;
+    clock::time_point deadline = clock::now();
+    while (this->_p->acqRunning.load(std::memory_order_acquire))
+    {
+        sleepUntil(deadline);
+        cycle.deadline = deadline;
+        cycle.start    = clock::now();
+        cycle.jitter   = cycle.start - deadline;
+
+        PLC_DATA raw = readAll(); //readAll() publica o snapshot bruto
+        cycle.readLatency = clock::now() - cycle.start;
+        const PLC_DATA conv = convAllData(raw);
+        this->_p->latestConv.store(conv);
+        publishSnapshot(raw, conv);
+        this->_p->latestCycle.store(cycle);
+        if (config.callback) config.callback(raw, cycle);
+        if (this->_p->stats.on())
+            this->_p->stats.cycleTime.record(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - cycle.start).count());
+
+        //Próximo prazo sempre múltiplo do período a partir do início: prazos que já
+        //passaram são pulados e contados como perdidos
+        cycle.cycle++;
+        deadline += period;
+        const clock::time_point now = clock::now();
+        if (period.count() > 0 && deadline < now)
+        {
+            const auto lost = (now - deadline) / period + 1;
+            cycle.missed += lost;
+            deadline += lost * period;
+        }
+    }
+}
+
+//Grava o fator key (x0, x1, y0, y1, A, B, K ou L) nos fatores de um canal
+static void setConvFactor(char* factors, PLC_CONV_KIND kind, const std::string& key, double value)
+{
+    if (kind == CONV_KIND_LIN)
+    {
+        CONV_LIN& conv = *reinterpret_cast<CONV_LIN*>(factors);
+        if      (key == "x0") conv.x0 = value;
+        else if (key == "x1") conv.x1 = value;
+        else if (key == "y0") conv.y0 = value;
+        else if (key == "y1") conv.y1 = value;
+    }
+    else if (kind == CONV_KIND_LOG)
+    {
+        CONV_LOG& conv = *reinterpret_cast<CONV_LOG*>(factors);
+        if      (key == "A") conv.A = value;
+        else if (key == "B") conv.B = value;
+    }
+    else if (kind == CONV_KIND_PER)
+    {
+        CONV_PER& conv = *reinterpret_cast<CONV_PER*>(factors);
+        if      (key == "K") conv.K = value;
+        else if (key == "L") conv.L = value;
+        //else if (key == "M") conv.M = value;
+        //else if (key == "N") conv.N = value;
+    }
+}
+
+//Lê os fatores e as bandas mortas do arquivo de conversão. Retorna 0 em caso de sucesso e 1
+//se o arquivo não pôde ser aberto ou tem valores inválidos (linhas inválidas são ignoradas).
+static bool parseFatorConvFile(const std::string& filename, CONV_PLC& fatorConv, PLC_DEADBANDS& deadbands)
+{
     std::ifstream infile(filename);
-    std::string line;
+    if (!infile) return 1;
 
+    bool error = false;
+    std::string line;
     std::string kind;
-
-    //cout << "before while\n";
     while (std::getline(infile, line)) 
     {
         // Remove espaços em branco no início e no fim da linha
@@ -222,127 +1308,208 @@ CONV_PLC libOpcTrigaPLC::readFatorConvFile(std::string filename)
             std::string key;
             std::string igual, valueS;
             iss >> key >> igual >> valueS;
-            double value = std::stod(valueS);
-
-            if (kind == "BarraReg") 
-            {
-                if      (key == "x0") fatorConv.BarraReg.x0 = value;
-                else if (key == "x1") fatorConv.BarraReg.x1 = value;
-                else if (key == "y0") fatorConv.BarraReg.y0 = value;
-                else if (key == "y1") fatorConv.BarraReg.y1 = value;
-            } 
-            else if (kind == "BarraCon") 
-            {
-                if      (key == "x0") fatorConv.BarraCon.x0 = value;
-                else if (key == "x1") fatorConv.BarraCon.x1 = value;
-                else if (key == "y0") fatorConv.BarraCon.y0 = value;
-                else if (key == "y1") fatorConv.BarraCon.y1 = value;
-            } 
-            else if (kind == "BarraSeg") 
-            {
-                if      (key == "x0") fatorConv.BarraSeg.x0 = value;
-                else if (key == "x1") fatorConv.BarraSeg.x1 = value;
-                else if (key == "y0") fatorConv.BarraSeg.y0 = value;
-                else if (key == "y1") fatorConv.BarraSeg.y1 = value;
-            } 
-            else if (kind == "CLogALin") 
-            {
-                if      (key == "x0") fatorConv.CLogALin.x0 = value;
-                else if (key == "x1") fatorConv.CLogALin.x1 = value;
-                else if (key == "y0") fatorConv.CLogALin.y0 = value;
-                else if (key == "y1") fatorConv.CLogALin.y1 = value;
-            } 
-            else if (kind == "CParALin") 
-            {
-                if      (key == "x0") fatorConv.CParALin.x0 = value;
-                else if (key == "x1") fatorConv.CParALin.x1 = value;
-                else if (key == "y0") fatorConv.CParALin.y0 = value;
-                else if (key == "y1") fatorConv.CParALin.y1 = value;
-            } 
-            else if (kind == "CLogARea") 
-            {
-                if      (key == "x0") fatorConv.CLogARea.x0 = value;
-                else if (key == "x1") fatorConv.CLogARea.x1 = value;
-                else if (key == "y0") fatorConv.CLogARea.y0 = value;
-                else if (key == "y1") fatorConv.CLogARea.y1 = value;
-            } 
-            else if (kind == "CLin") 
-            {
-                if      (key == "x0") fatorConv.CLin.x0 = value;
-                else if (key == "x1") fatorConv.CLin.x1 = value;
-                else if (key == "y0") fatorConv.CLin.y0 = value;
-                else if (key == "y1") fatorConv.CLin.y1 = value;
-            } 
-            else if (kind == "CPer") 
-            {
-                if      (key == "x0") fatorConv.CPer.x0 = value;
-                else if (key == "x1") fatorConv.CPer.x1 = value;
-                else if (key == "y0") fatorConv.CPer.y0 = value;
-                else if (key == "y1") fatorConv.CPer.y1 = value;
-            } 
-            else if (kind == "SVasPri") 
+            char* end;
+            double value = std::strtod(valueS.c_str(), &end);
+            if (valueS.empty() || *end != '\0')
             {
-                if      (key == "x0") fatorConv.SVasPri.x0 = value;
-                else if (key == "x1") fatorConv.SVasPri.x1 = value;
-                else if (key == "y0") fatorConv.SVasPri.y0 = value;
-                else if (key == "y1") fatorConv.SVasPri.y1 = value;
-            } 
-            else if (kind == "CLogALog") 
-            {
-                if      (key == "A") fatorConv.CLogALog.A = value;
-                else if (key == "B") fatorConv.CLogALog.B = value;
-            } 
-            else if (kind == "CParALog") 
-            {
-                if      (key == "A") fatorConv.CParALog.A = value;
-                else if (key == "B") fatorConv.CParALog.B = value;
-            } 
-            else if (kind == "SRadAre") 
-            {
-                if      (key == "A") fatorConv.SRadAre.A = value;
-                else if (key == "B") fatorConv.SRadAre.B = value;
-            } 
-            else if (kind == "SRadEntPri") 
-            {
-                if      (key == "A") fatorConv.SRadEntPri.A = value;
-                else if (key == "B") fatorConv.SRadEntPri.B = value;
-            } 
-            else if (kind == "SRadPoc") 
-            {
-                if      (key == "A") fatorConv.SRadPoc.A = value;
-                else if (key == "B") fatorConv.SRadPoc.B = value;
-            } 
-            else if (kind == "SRadRes") 
-            {
-                if      (key == "A") fatorConv.SRadRes.A = value;
-                else if (key == "B") fatorConv.SRadRes.B = value;
-            } 
-            else if (kind == "SRadSaiSec") 
-            {
-                if      (key == "A") fatorConv.SRadSaiSec.A = value;
-                else if (key == "B") fatorConv.SRadSaiSec.B = value;
-            } 
-            else if (kind == "SRadAer") 
-            {
-                if      (key == "A") fatorConv.SRadAer.A = value;
-                else if (key == "B") fatorConv.SRadAer.B = value;
-            } 
-            else if (kind == "CLogAPer") 
-            {
-                if      (key == "K") fatorConv.CLogAPer.K = value;
-                else if (key == "L") fatorConv.CLogAPer.L = value;
-                //else if (key == "M") fatorConv.CLogAPer.M = value;
-                //else if (key == "N") fatorConv.CLogAPer.N = value;
-            } 
-            else if (kind == "CParAPer") 
+                error = true;
+                continue;
+            }
+
+            for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
             {
-                if      (key == "K") fatorConv.CParAPer.K = value;
-                else if (key == "L") fatorConv.CParAPer.L = value;
-                //else if (key == "M") fatorConv.CParAPer.M = value;
-                //else if (key == "N") fatorConv.CParAPer.N = value;
+                const PLC_CHANNEL_INFO& c = PLC_CHANNELS[ch];
+                if (kind == c.name)
+                {
+                    if      (key == "deadband")     deadbands[ch].abs = value;
+                    else if (key == "deadband_pct") deadbands[ch].pct = value;
+                    else setConvFactor(reinterpret_cast<char*>(&fatorConv) + c.convOffset, c.convKind, key, value);
+                    break;
+                }
             }
         }
     }
+    return error;
+}
+
+CONV_PLC libOpcTrigaPLC::readFatorConvFile(std::string filename)
+{
+    CONV_PLC fatorConv;
+    if (filename=="") return fatorConv;
+
+    PLC_DEADBANDS deadbands;
+    if (parseFatorConvFile(filename, fatorConv, deadbands))
+        reportError(ERR_FILE, "readFatorConvFile()", "Erro ao ler o arquivo de conversão", 0, -1, filename.c_str());
+    this->_p->deadbands.store(std::make_shared<const PLC_DEADBANDS>(deadbands), std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(this->_p->convFileMutex);
+        this->_p->convFile = filename;
+    }
 
+    //Compila as tabelas já na leitura do arquivo, fora do caminho de conversão
+    this->_p->convTable.store(compileConv(fatorConv), std::memory_order_release);
     return fatorConv;
 }
+
+libOpcTrigaPLCChangeFilter::libOpcTrigaPLCChangeFilter(const PLC_DEADBANDS& deadbands)
+{
+    this->deadbands = deadbands;
+}
+
+void libOpcTrigaPLCChangeFilter::setDeadbands(const PLC_DEADBANDS& deadbands)
+{
+    this->deadbands = deadbands;
+}
+
+bool libOpcTrigaPLCChangeFilter::readDeadbandFile(std::string filename)
+{
+    CONV_PLC fatorConv;
+    PLC_DEADBANDS deadbands;
+    if (parseFatorConvFile(filename, fatorConv, deadbands)) return 1;
+    this->deadbands = deadbands;
+    return 0;
+}
+
+void libOpcTrigaPLCChangeFilter::reset()
+{
+    this->reported = 0;
+}
+
+size_t libOpcTrigaPLCChangeFilter::filter(const PLC_DATA& data, std::vector<PLC_CHANGE>& changes)
+{
+    size_t n = 0;
+    for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+    {
+        const PLC_MASK bit = PLC_MASK(1) << ch;
+        if (!(data.MASK & bit)) continue;
+
+        const float x = (PLC_CHANNELS[ch].rawType == RAW_SCALE_BITS) ? data.CLinScale : plcField(data, ch);
+        const uint32_t status = data.STATUS[ch];
+        if ((this->reported & bit) && status == this->lastStatus[ch])
+        {
+            const float limit = std::max(this->deadbands[ch].abs, this->deadbands[ch].pct / 100 * std::fabs(this->last[ch]));
+            if (!(std::fabs(x - this->last[ch]) > limit)) continue;
+        }
+
+        this->reported |= bit;
+        this->last[ch]       = x;
+        this->lastStatus[ch] = status;
+        changes.push_back(PLC_CHANGE{PLC_CHANNEL(ch), x, status, data.TIME});
+        n++;
+    }
+    return n;
+}
+
+size_t libOpcTrigaPLC::get_changes(std::vector<PLC_CHANGE>& changes)
+{
+    const PLC_DATA data = get_all_conv();
+    std::lock_guard<std::mutex> lock(this->_p->changeMutex);
+    this->_p->changeFilter.setDeadbands(*this->_p->deadbands.load(std::memory_order_acquire));
+    return this->_p->changeFilter.filter(data, changes);
+}
+
+void libOpcTrigaPLC::resetChanges()
+{
+    std::lock_guard<std::mutex> lock(this->_p->changeMutex);
+    this->_p->changeFilter.reset();
+}
+
+PLC_DEADBANDS libOpcTrigaPLC::getDeadbands()
+{
+    return *this->_p->deadbands.load(std::memory_order_acquire);
+}
+
+void libOpcTrigaPLC::setDeadbands(const PLC_DEADBANDS& deadbands)
+{
+    this->_p->deadbands.store(std::make_shared<const PLC_DEADBANDS>(deadbands), std::memory_order_release);
+}
+
+bool libOpcTrigaPLC::reloadFatorConvFile()
+{
+    std::string filename;
+    {
+        std::lock_guard<std::mutex> lock(this->_p->convFileMutex);
+        filename = this->_p->convFile;
+    }
+    return reloadConv(filename);
+}
+
+//Lê o arquivo e publica os novos fatores. Um arquivo inválido mantém os fatores em uso.
+bool libOpcTrigaPLC::reloadConv(const std::string& filename)
+{
+    CONV_PLC factors;
+    PLC_DEADBANDS deadbands;
+    if (filename.empty() || parseFatorConvFile(filename, factors, deadbands))
+    {
+        reportError(ERR_FILE, "reloadFatorConvFile()", "Erro ao ler o arquivo de conversão, fatores mantidos", 0, -1, filename.c_str());
+        return 1;
+    }
+    this->_p->deadbands.store(std::make_shared<const PLC_DEADBANDS>(deadbands), std::memory_order_release);
+
+    const std::shared_ptr<const CONV_TABLE> current = convTable();
+    if (current->source == factors) return 0;
+    this->_p->convTable.store(compileConv(factors), std::memory_order_release);
+    return 0;
+}
+
+bool libOpcTrigaPLC::watchFatorConvFile(std::string filename)
+{
+    if (this->_p->watchRunning.exchange(true)) return 1;
+    {
+        std::lock_guard<std::mutex> lock(this->_p->convFileMutex);
+        if (filename.empty()) filename = this->_p->convFile;
+        else                  this->_p->convFile = filename;
+    }
+
+    //Observa o diretório e não o arquivo: editores costumam salvar em um arquivo
+    //temporário e renomeá-lo por cima do original
+    const std::filesystem::path path(filename);
+    const std::string dir = path.has_parent_path() ? path.parent_path().string() : ".";
+    this->_p->watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (filename.empty() || this->_p->watchFd < 0 ||
+        inotify_add_watch(this->_p->watchFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        reportError(ERR_FILE, "watchFatorConvFile()", "Erro ao observar o arquivo de conversão", 0, -1,
+                    filename.empty() ? "nenhum arquivo" : std::strerror(errno));
+        if (this->_p->watchFd >= 0) ::close(this->_p->watchFd);
+        this->_p->watchFd = -1;
+        this->_p->watchRunning = false;
+        return 1;
+    }
+    this->_p->watchFile   = filename;
+    this->_p->watchThread = std::thread(&libOpcTrigaPLC::watchLoop, this);
+    return 0;
+}
+
+void libOpcTrigaPLC::unwatchFatorConvFile()
+{
+    this->_p->watchRunning = false;
+    if (this->_p->watchThread.joinable()) this->_p->watchThread.join();
+    if (this->_p->watchFd >= 0) ::close(this->_p->watchFd);
+    this->_p->watchFd = -1;
+}
+
+//Laço da thread de recarga: espera eventos do inotify e recarrega quando o arquivo muda
+void libOpcTrigaPLC::watchLoop()
+{
+    const std::string name = std::filesystem::path(this->_p->watchFile).filename().string();
+    alignas(inotify_event) char buf[4096];
+    pollfd pfd{this->_p->watchFd, POLLIN, 0};
+    while (this->_p->watchRunning)
+    {
+        if (poll(&pfd, 1, 200) <= 0) continue;
+
+        bool changed = false;
+        ssize_t len;
+        while ((len = ::read(this->_p->watchFd, buf, sizeof(buf))) > 0)
+        {
+            for (char* ptr = buf; ptr < buf + len; )
+            {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+                if (event->len && name == event->name) changed = true;
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+        if (changed) reloadConv(this->_p->watchFile);
+    }
+}
@@ -0,0 +1,516 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <libOpcTrigaPLCArchive.h>
+#include "errorMsg.h"
+#include <fstream>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char     ARC_MAGIC[8]   = {'T','R','I','G','A','A','R','C'};
+static const char     BLOCK_MAGIC[4] = {'A','B','L','K'};
+static const uint32_t ARC_VERSION    = 1;
+
+//-------------------------------------------------------------------- Codificação
+
+//CRC-32 (polinômio 0xEDB88320, o mesmo de zlib), com tabela de 256 entradas
+static uint32_t crc32Update(uint32_t crc, const void* data, size_t bytes)
+{
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < bytes; i++) crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static uint32_t blockCrc(ARC_BLOCK_HEADER header, const uint8_t* data)
+{
+    header.crc = 0;
+    return crc32Update(crc32Update(0, &header, sizeof(header)), data, header.bytes);
+}
+
+//Menor número de bits por amostra após a primeira: TIME, MASK/STATE e cada canal inalterados
+static constexpr size_t MIN_SAMPLE_BITS = 2 + PLC_N_CHANNELS;
+
+//Fluxo de bits, do bit mais significativo para o menos significativo
+class BitWriter
+{
+public:
+    BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void put(uint32_t value, int bits) //bits <= 32
+    {
+        acc_ = (acc_ << bits) | (bits == 32 ? value : value & ((1u << bits) - 1));
+        n_ += bits;
+        while (n_ >= 8)
+        {
+            n_ -= 8;
+            out_.push_back(uint8_t(acc_ >> n_));
+        }
+    }
+
+    void put64(uint64_t value)
+    {
+        put(uint32_t(value >> 32), 32);
+        put(uint32_t(value), 32);
+    }
+
+    void finish()
+    {
+        if (n_ > 0) out_.push_back(uint8_t(acc_ << (8 - n_)));
+        n_ = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint64_t acc_ = 0;
+    int n_ = 0;
+};
+
+class BitReader
+{
+public:
+    BitReader(const uint8_t* data, size_t bytes) : p_(data), end_(data + bytes) {}
+
+    uint32_t get(int bits) //bits <= 32
+    {
+        while (n_ < bits)
+        {
+            if (p_ < end_) acc_ = (acc_ << 8) | *p_++;
+            else
+            {
+                acc_ <<= 8;
+                overrun_ = true;
+            }
+            n_ += 8;
+        }
+        n_ -= bits;
+        return bits == 32 ? uint32_t(acc_ >> n_) : uint32_t(acc_ >> n_) & ((1u << bits) - 1);
+    }
+
+    uint64_t get64()
+    {
+        const uint64_t high = get(32);
+        return (high << 32) | get(32);
+    }
+
+    bool bit() { return get(1); }
+    bool overrun() const { return overrun_; }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+    uint64_t acc_ = 0;
+    int n_ = 0;
+    bool overrun_ = false;
+};
+
+static inline uint64_t zigzag(int64_t x)  { return (uint64_t(x) << 1) ^ uint64_t(x >> 63); }
+static inline int64_t  unzigzag(uint64_t x) { return int64_t(x >> 1) ^ -int64_t(x & 1); }
+
+//Delta-of-delta de TIME: '0' | '10' + 12 bits | '110' + 24 bits | '1110' + 32 bits | '1111' + 64 bits
+static void putTime(BitWriter& w, int64_t dod)
+{
+    const uint64_t z = zigzag(dod);
+    if      (z == 0)            w.put(0b0, 1);
+    else if (z < (1ull << 12)) { w.put(0b10, 2);   w.put(z, 12); }
+    else if (z < (1ull << 24)) { w.put(0b110, 3);  w.put(z, 24); }
+    else if (z < (1ull << 32)) { w.put(0b1110, 4); w.put(z, 32); }
+    else                       { w.put(0b1111, 4); w.put64(z); }
+}
+
+static int64_t getTime(BitReader& r)
+{
+    if (!r.bit()) return 0;
+    if (!r.bit()) return unzigzag(r.get(12));
+    if (!r.bit()) return unzigzag(r.get(24));
+    if (!r.bit()) return unzigzag(r.get(32));
+    return unzigzag(r.get64());
+}
+
+//Diferença de um canal: '0' | '10' + 4 bits | '110' + 8 bits | '111' + 17 bits
+static void putValue(BitWriter& w, int32_t delta)
+{
+    const uint32_t z = zigzag(delta);
+    if      (z == 0)         w.put(0b0, 1);
+    else if (z < (1u << 4)) { w.put(0b10, 2);  w.put(z, 4); }
+    else if (z < (1u << 8)) { w.put(0b110, 3); w.put(z, 8); }
+    else                    { w.put(0b111, 3); w.put(z, 17); }
+}
+
+static int32_t getValue(BitReader& r)
+{
+    if (!r.bit()) return 0;
+    if (!r.bit()) return unzigzag(r.get(4));
+    if (!r.bit()) return unzigzag(r.get(8));
+    return unzigzag(r.get(17));
+}
+
+void archiveEncode(const PLC_RECORD* records, size_t n, std::vector<uint8_t>& out)
+{
+    out.clear();
+    if (n == 0) return;
+    BitWriter w(out);
+
+    const PLC_RECORD& first = records[0];
+    w.put64(first.time);
+    w.put(first.mask, 32);
+    w.put(uint16_t(first.state), 16);
+    for (int ch = 0; ch < PLC_N_CHANNELS; ch++) w.put(uint16_t(first.raw[ch]), 16);
+
+    int64_t prevDelta = 0;
+    for (size_t i = 1; i < n; i++)
+    {
+        const PLC_RECORD& prev = records[i - 1];
+        const PLC_RECORD& rec  = records[i];
+
+        const int64_t delta = rec.time - prev.time;
+        putTime(w, delta - prevDelta);
+        prevDelta = delta;
+
+        if (rec.mask == prev.mask && rec.state == prev.state) w.put(0, 1);
+        else
+        {
+            w.put(1, 1);
+            w.put(rec.mask, 32);
+            w.put(uint16_t(rec.state), 16);
+        }
+
+        for (int ch = 0; ch < PLC_N_CHANNELS; ch++) putValue(w, int32_t(rec.raw[ch]) - prev.raw[ch]);
+    }
+    w.finish();
+}
+
+bool archiveDecode(const uint8_t* data, size_t bytes, size_t n, PLC_RECORD* out)
+{
+    if (n == 0) return 0;
+    BitReader r(data, bytes);
+
+    PLC_RECORD rec{};
+    rec.time  = r.get64();
+    rec.mask  = r.get(32);
+    rec.state = int16_t(r.get(16));
+    for (int ch = 0; ch < PLC_N_CHANNELS; ch++) rec.raw[ch] = int16_t(r.get(16));
+    out[0] = rec;
+
+    int64_t delta = 0;
+    for (size_t i = 1; i < n; i++)
+    {
+        delta    += getTime(r);
+        rec.time += delta;
+        if (r.bit())
+        {
+            rec.mask  = r.get(32);
+            rec.state = int16_t(r.get(16));
+        }
+        for (int ch = 0; ch < PLC_N_CHANNELS; ch++) rec.raw[ch] = int16_t(rec.raw[ch] + getValue(r));
+        out[i] = rec;
+    }
+    return r.overrun();
+}
+
+//-------------------------------------------------------------------- Gravação
+
+struct libOpcTrigaPLCArchiveWriter_private {
+    std::ofstream file;
+    std::vector<PLC_RECORD> block;  //Bloco em andamento, capacidade reservada uma única vez
+    std::vector<uint8_t> encoded;
+    uint32_t blockCapacity;
+    uint64_t total = 0;
+    uint64_t bytes = 0;
+};
+
+libOpcTrigaPLCArchiveWriter::libOpcTrigaPLCArchiveWriter(std::string filename, const CONV_PLC& fatorConv, uint32_t blockCapacity)
+{
+    this->_p = new libOpcTrigaPLCArchiveWriter_private;
+    this->_p->blockCapacity = std::max<uint32_t>(blockCapacity, 1);
+    this->_p->block.reserve(this->_p->blockCapacity);
+
+    this->_p->file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!this->_p->file)
+    {
+        std::cerr << plcErrorMsg("libOpcTrigaPLCArchiveWriter", "libOpcTrigaPLCArchiveWriter()", "Erro ao criar " + filename);
+        return;
+    }
+
+    ARC_FILE_HEADER header{};
+    std::memcpy(header.magic, ARC_MAGIC, sizeof(ARC_MAGIC));
+    header.version       = ARC_VERSION;
+    header.nChannels     = PLC_N_CHANNELS;
+    header.blockCapacity = this->_p->blockCapacity;
+    header.fatorConv     = fatorConv;
+    this->_p->file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    this->_p->bytes = sizeof(header);
+}
+
+libOpcTrigaPLCArchiveWriter::~libOpcTrigaPLCArchiveWriter()
+{
+    flush();
+    delete this->_p;
+}
+
+bool libOpcTrigaPLCArchiveWriter::isOpen() const
+{
+    return this->_p->file.is_open() && this->_p->file.good();
+}
+
+bool libOpcTrigaPLCArchiveWriter::append(const PLC_DATA& raw)
+{
+    if (!isOpen()) return 1;
+    this->_p->block.push_back(plcToRecord(raw));
+    this->_p->total++;
+    if (this->_p->block.size() >= this->_p->blockCapacity) return flush();
+    return 0;
+}
+
+bool libOpcTrigaPLCArchiveWriter::flush()
+{
+    if (!isOpen()) return 1;
+    std::vector<PLC_RECORD>& block = this->_p->block;
+    if (!block.empty())
+    {
+        archiveEncode(block.data(), block.size(), this->_p->encoded);
+
+        ARC_BLOCK_HEADER header{};
+        std::memcpy(header.magic, BLOCK_MAGIC, sizeof(BLOCK_MAGIC));
+        header.count     = block.size();
+        header.firstTime = block.front().time;
+        header.lastTime  = block.back().time;
+        header.bytes     = this->_p->encoded.size();
+        header.crc       = blockCrc(header, this->_p->encoded.data());
+        this->_p->file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        this->_p->file.write(reinterpret_cast<const char*>(this->_p->encoded.data()), this->_p->encoded.size());
+        this->_p->bytes += sizeof(header) + this->_p->encoded.size();
+        block.clear();
+    }
+    this->_p->file.flush();
+    if (!this->_p->file)
+    {
+        std::cerr << plcErrorMsg("libOpcTrigaPLCArchiveWriter", "flush()", "Erro ao gravar arquivo");
+        return 1;
+    }
+    return 0;
+}
+
+uint64_t libOpcTrigaPLCArchiveWriter::size() const
+{
+    return this->_p->total;
+}
+
+uint64_t libOpcTrigaPLCArchiveWriter::bytes() const
+{
+    return this->_p->bytes;
+}
+
+//-------------------------------------------------------------------- Leitura
+
+struct ARC_BLOCK
+{
+    const uint8_t* data;
+    size_t bytes;
+    size_t count;
+    ARC_BLOCK_HEADER header; //Cópia do cabeçalho, para conferir o CRC
+    size_t firstIndex; //Índice global da primeira amostra do bloco
+    int64_t firstTime;
+    int64_t lastTime;
+    bool corrupt = false; //Falhou na decodificação (relatado uma única vez)
+};
+
+struct libOpcTrigaPLCArchiveReader_private {
+    const char* map = nullptr;
+    size_t mapSize = 0;
+    const ARC_FILE_HEADER* header = nullptr;
+    std::vector<ARC_BLOCK> blocks;
+    size_t total = 0;
+
+    //Último bloco decodificado
+    size_t cachedBlock = SIZE_MAX;
+    std::vector<PLC_RECORD> cache;
+};
+
+libOpcTrigaPLCArchiveReader::libOpcTrigaPLCArchiveReader(std::string filename)
+{
+    this->_p = new libOpcTrigaPLCArchiveReader_private;
+
+    const int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ARC_FILE_HEADER))
+    {
+        std::cerr << plcErrorMsg("libOpcTrigaPLCArchiveReader", "libOpcTrigaPLCArchiveReader()", "Erro ao abrir " + filename);
+        if (fd >= 0) close(fd);
+        return;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        std::cerr << plcErrorMsg("libOpcTrigaPLCArchiveReader", "libOpcTrigaPLCArchiveReader()", "Erro no mmap de " + filename);
+        return;
+    }
+    this->_p->map     = static_cast<const char*>(map);
+    this->_p->mapSize = st.st_size;
+
+    const ARC_FILE_HEADER* header = reinterpret_cast<const ARC_FILE_HEADER*>(this->_p->map);
+    if (std::memcmp(header->magic, ARC_MAGIC, sizeof(ARC_MAGIC)) != 0 || header->version != ARC_VERSION ||
+        header->nChannels != PLC_N_CHANNELS)
+    {
+        std::cerr << plcErrorMsg("libOpcTrigaPLCArchiveReader", "libOpcTrigaPLCArchiveReader()", "Formato inválido: " + filename);
+        return;
+    }
+    this->_p->header = header;
+
+    //Índice dos blocos; um bloco truncado no fim do arquivo (gravação interrompida) é ignorado.
+    //count vem do arquivo: é limitado pelo que bytes pode codificar antes de qualquer alocação.
+    size_t offset = sizeof(ARC_FILE_HEADER);
+    while (offset + sizeof(ARC_BLOCK_HEADER) <= this->_p->mapSize)
+    {
+        ARC_BLOCK_HEADER block;
+        std::memcpy(&block, this->_p->map + offset, sizeof(block));
+        if (std::memcmp(block.magic, BLOCK_MAGIC, sizeof(BLOCK_MAGIC)) != 0) break;
+        if (offset + sizeof(ARC_BLOCK_HEADER) + block.bytes > this->_p->mapSize) break;
+        if (block.count == 0 || block.count > header->blockCapacity ||
+            block.count > 1 + size_t(block.bytes) * 8 / MIN_SAMPLE_BITS)
+        {
+            std::cerr << plcErrorMsg("libOpcTrigaPLCArchiveReader", "libOpcTrigaPLCArchiveReader()",
+                                     "Bloco com número de amostras inválido, arquivo lido até " + std::to_string(offset));
+            break;
+        }
+
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(this->_p->map + offset + sizeof(ARC_BLOCK_HEADER));
+        this->_p->blocks.push_back({data, block.bytes, block.count, block, this->_p->total, block.firstTime, block.lastTime});
+        this->_p->total += block.count;
+        offset += sizeof(ARC_BLOCK_HEADER) + block.bytes;
+    }
+}
+
+libOpcTrigaPLCArchiveReader::~libOpcTrigaPLCArchiveReader()
+{
+    if (this->_p->map) munmap(const_cast<char*>(this->_p->map), this->_p->mapSize);
+    delete this->_p;
+}
+
+bool libOpcTrigaPLCArchiveReader::isOpen() const
+{
+    return this->_p->header != nullptr;
+}
+
+CONV_PLC libOpcTrigaPLCArchiveReader::fatorConv() const
+{
+    if (!this->_p->header) return CONV_PLC{};
+    return this->_p->header->fatorConv;
+}
+
+size_t libOpcTrigaPLCArchiveReader::size() const
+{
+    return this->_p->total;
+}
+
+size_t libOpcTrigaPLCArchiveReader::blockCount() const
+{
+    return this->_p->blocks.size();
+}
+
+//Confere o CRC e decodifica o bloco b em out. Retorna 0 em caso de sucesso e 1 em caso de erro.
+static bool decodeBlock(const libOpcTrigaPLCArchiveReader_private* p, size_t b, std::vector<PLC_RECORD>& out)
+{
+    const ARC_BLOCK& block = p->blocks[b];
+    if (blockCrc(block.header, block.data) != block.header.crc) return 1;
+    out.resize(block.count);
+    return archiveDecode(block.data, block.bytes, block.count, out.data());
+}
+
+//Coloca o bloco b no cache. Um bloco corrompido é relatado na primeira falha e depois
+//apenas recusado, sem nova decodificação. Retorna 0 em caso de sucesso e 1 em caso de erro.
+static bool loadBlock(libOpcTrigaPLCArchiveReader_private* p, size_t b, const char* function)
+{
+    if (b == p->cachedBlock) return 0;
+    ARC_BLOCK& block = p->blocks[b];
+    if (block.corrupt) return 1;
+    if (decodeBlock(p, b, p->cache))
+    {
+        block.corrupt  = true;
+        p->cachedBlock = SIZE_MAX;
+        p->cache.clear();
+        std::cerr << plcErrorMsg("libOpcTrigaPLCArchiveReader", function, "Bloco " + std::to_string(b) + " corrompido, amostras " +
+                                 std::to_string(block.firstIndex) + " a " + std::to_string(block.firstIndex + block.count - 1) + " indisponíveis");
+        return 1;
+    }
+    p->cachedBlock = b;
+    return 0;
+}
+
+bool libOpcTrigaPLCArchiveReader::readBlock(size_t b, std::vector<PLC_RECORD>& out) const
+{
+    if (b >= this->_p->blocks.size()) return 1;
+    return decodeBlock(this->_p, b, out);
+}
+
+bool libOpcTrigaPLCArchiveReader::record(size_t i, PLC_RECORD& rec)
+{
+    const std::vector<ARC_BLOCK>& blocks = this->_p->blocks;
+    if (i >= this->_p->total) return 1;
+    auto it = std::upper_bound(blocks.begin(), blocks.end(), i,
+                               [](size_t index, const ARC_BLOCK& b) { return index < b.firstIndex; });
+    const size_t b = (it - 1) - blocks.begin();
+    if (loadBlock(this->_p, b, "record()")) return 1;
+    rec = this->_p->cache[i - blocks[b].firstIndex];
+    return 0;
+}
+
+bool libOpcTrigaPLCArchiveReader::get(size_t i, PLC_DATA& raw)
+{
+    PLC_RECORD rec;
+    if (record(i, rec)) return 1;
+    raw = recordToPlc(rec);
+    return 0;
+}
+
+//Busca binária: primeiro nos intervalos de tempo dos blocos, depois dentro do bloco decodificado
+size_t libOpcTrigaPLCArchiveReader::lowerBound(std::chrono::system_clock::time_point t)
+{
+    const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    const std::vector<ARC_BLOCK>& blocks = this->_p->blocks;
+
+    auto block = std::lower_bound(blocks.begin(), blocks.end(), ns,
+                                  [](const ARC_BLOCK& b, int64_t time) { return b.lastTime < time; });
+    if (block == blocks.end()) return this->_p->total;
+    if (block->firstTime >= ns) return block->firstIndex;
+
+    //A busca dentro do bloco exige o bloco decodificado no cache
+    if (loadBlock(this->_p, block - blocks.begin(), "lowerBound()")) return this->_p->total;
+    const std::vector<PLC_RECORD>& cache = this->_p->cache;
+    auto rec = std::lower_bound(cache.begin(), cache.end(), ns,
+                                [](const PLC_RECORD& r, int64_t time) { return r.time < time; });
+    return block->firstIndex + (rec - cache.begin());
+}
@@ -0,0 +1,272 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <libOpcTrigaPLCHistory.h>
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+
+static constexpr size_t BLOCK = 64; //Amostras por bloco resumido
+
+//Resumo de um trecho de amostras válidas de um canal
+struct HIST_NODE
+{
+    float    min   = std::numeric_limits<float>::infinity();
+    float    max   = -std::numeric_limits<float>::infinity();
+    double   sum   = 0;
+    uint64_t count = 0;
+    uint64_t last  = 0; //Índice absoluto da amostra válida mais recente (se count > 0)
+};
+
+static inline HIST_NODE merge(const HIST_NODE& a, const HIST_NODE& b)
+{
+    HIST_NODE n;
+    n.min   = std::min(a.min, b.min);
+    n.max   = std::max(a.max, b.max);
+    n.sum   = a.sum + b.sum;
+    n.count = a.count + b.count;
+    n.last  = std::max(a.last, b.last); //Índices absolutos crescem com o tempo
+    return n;
+}
+
+static inline void add(HIST_NODE& n, float x, uint64_t i)
+{
+    n.min = std::min(n.min, x);
+    n.max = std::max(n.max, x);
+    n.sum += x;
+    n.count++;
+    n.last = std::max(n.last, i);
+}
+
+//Amostras são numeradas de forma absoluta (0 = primeira gravada); a amostra i fica na
+//posição i % capacity das colunas e pertence ao bloco físico (i / BLOCK) % nBlocks.
+//A árvore guarda, para cada canal, o resumo de cada bloco completo nas folhas.
+struct libOpcTrigaPLCHistory_private {
+    mutable std::shared_mutex mutex;
+    size_t capacity;
+    size_t nBlocks;
+    size_t treeSize;              //Número de folhas (potência de 2 >= nBlocks)
+    uint64_t head = 0;            //Amostras já gravadas
+    std::vector<int64_t> time;    //TIME em ns desde a época Unix
+    std::vector<PLC_MASK> valid;  //Canais válidos de cada amostra
+    std::vector<float> values;    //Canal ch em [ch * capacity, (ch + 1) * capacity)
+    std::vector<HIST_NODE> tree;  //Canal ch em [ch * 2 * treeSize, (ch + 1) * 2 * treeSize), raiz em 1
+
+    float value(int ch, uint64_t i) const { return values[ch * capacity + i % capacity]; }
+    bool  isValid(int ch, uint64_t i) const { return valid[i % capacity] & (PLC_MASK(1) << ch); }
+    uint64_t first() const { return head > capacity ? head - capacity : 0; }
+
+    void setLeaf(int ch, size_t block, const HIST_NODE& node)
+    {
+        HIST_NODE* t = &tree[ch * 2 * treeSize];
+        size_t i = treeSize + block;
+        t[i] = node;
+        for (i /= 2; i >= 1; i /= 2) t[i] = merge(t[2 * i], t[2 * i + 1]);
+    }
+
+    //Resumo dos blocos físicos [lo, hi)
+    HIST_NODE query(int ch, size_t lo, size_t hi) const
+    {
+        const HIST_NODE* t = &tree[ch * 2 * treeSize];
+        HIST_NODE acc;
+        for (lo += treeSize, hi += treeSize; lo < hi; lo /= 2, hi /= 2)
+        {
+            if (lo & 1) acc = merge(acc, t[lo++]);
+            if (hi & 1) acc = merge(acc, t[--hi]);
+        }
+        return acc;
+    }
+
+    void scan(int ch, uint64_t begin, uint64_t end, HIST_NODE& acc) const
+    {
+        for (uint64_t i = begin; i < end; i++)
+            if (isValid(ch, i)) add(acc, value(ch, i), i);
+    }
+
+    //Primeira amostra com tempo >= t
+    uint64_t lowerBound(int64_t t) const
+    {
+        uint64_t lo = first();
+        uint64_t hi = head;
+        while (lo < hi)
+        {
+            const uint64_t mid = lo + (hi - lo) / 2;
+            if (time[mid % capacity] < t) lo = mid + 1;
+            else                          hi = mid;
+        }
+        return lo;
+    }
+};
+
+static int64_t toNs(std::chrono::system_clock::time_point t)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+static std::chrono::system_clock::time_point fromNs(int64_t ns)
+{
+    return std::chrono::system_clock::time_point(
+               std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(ns)));
+}
+
+libOpcTrigaPLCHistory::libOpcTrigaPLCHistory(size_t capacity)
+{
+    this->_p = new libOpcTrigaPLCHistory_private;
+    this->_p->nBlocks  = std::max<size_t>((capacity + BLOCK - 1) / BLOCK, 1);
+    this->_p->capacity = this->_p->nBlocks * BLOCK;
+    this->_p->treeSize = 1;
+    while (this->_p->treeSize < this->_p->nBlocks) this->_p->treeSize *= 2;
+
+    this->_p->time.resize(this->_p->capacity);
+    this->_p->valid.resize(this->_p->capacity);
+    this->_p->values.resize(PLC_N_CHANNELS * this->_p->capacity);
+    this->_p->tree.resize(PLC_N_CHANNELS * 2 * this->_p->treeSize);
+}
+
+libOpcTrigaPLCHistory::~libOpcTrigaPLCHistory()
+{
+    delete this->_p;
+}
+
+void libOpcTrigaPLCHistory::append(const PLC_DATA& data)
+{
+    std::unique_lock<std::shared_mutex> lock(this->_p->mutex);
+    libOpcTrigaPLCHistory_private& h = *this->_p;
+    const size_t pos   = h.head % h.capacity;
+    const size_t block = pos / BLOCK;
+
+    //Início de um bloco: o resumo do bloco sobrescrito deixa de valer
+    if (pos % BLOCK == 0 && h.head >= h.capacity)
+        for (int ch = 0; ch < PLC_N_CHANNELS; ch++) h.setLeaf(ch, block, HIST_NODE{});
+
+    int64_t t = toNs(data.TIME);
+    if (h.head > 0) t = std::max(t, h.time[(h.head - 1) % h.capacity]);
+    h.time[pos] = t;
+
+    PLC_MASK valid = 0;
+    for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+    {
+        const float x = (PLC_CHANNELS[ch].rawType == RAW_SCALE_BITS) ? data.CLinScale : plcField(data, ch);
+        h.values[ch * h.capacity + pos] = x;
+        if (!data.STALE && (data.MASK & (PLC_MASK(1) << ch)) && plcStatusUsable(data.STATUS[ch])) valid |= PLC_MASK(1) << ch;
+    }
+    h.valid[pos] = valid;
+    h.head++;
+
+    //Fim de um bloco: resume o bloco na árvore
+    if ((pos + 1) % BLOCK == 0)
+    {
+        for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+        {
+            HIST_NODE node;
+            h.scan(ch, h.head - BLOCK, h.head, node);
+            h.setLeaf(ch, block, node);
+        }
+    }
+}
+
+void libOpcTrigaPLCHistory::clear()
+{
+    std::unique_lock<std::shared_mutex> lock(this->_p->mutex);
+    this->_p->head = 0;
+    std::fill(this->_p->tree.begin(), this->_p->tree.end(), HIST_NODE{});
+}
+
+size_t libOpcTrigaPLCHistory::capacity() const
+{
+    return this->_p->capacity;
+}
+
+size_t libOpcTrigaPLCHistory::size() const
+{
+    std::shared_lock<std::shared_mutex> lock(this->_p->mutex);
+    return this->_p->head - this->_p->first();
+}
+
+std::chrono::system_clock::time_point libOpcTrigaPLCHistory::firstTime() const
+{
+    std::shared_lock<std::shared_mutex> lock(this->_p->mutex);
+    if (this->_p->head == 0) return {};
+    return fromNs(this->_p->time[this->_p->first() % this->_p->capacity]);
+}
+
+std::chrono::system_clock::time_point libOpcTrigaPLCHistory::lastTime() const
+{
+    std::shared_lock<std::shared_mutex> lock(this->_p->mutex);
+    if (this->_p->head == 0) return {};
+    return fromNs(this->_p->time[(this->_p->head - 1) % this->_p->capacity]);
+}
+
+PLC_AGGREGATE libOpcTrigaPLCHistory::aggregate(int ch, std::chrono::system_clock::time_point t0,
+                                               std::chrono::system_clock::time_point t1) const
+{
+    PLC_AGGREGATE result;
+    if (ch < 0 || ch >= PLC_N_CHANNELS) return result;
+
+    std::shared_lock<std::shared_mutex> lock(this->_p->mutex);
+    const libOpcTrigaPLCHistory_private& h = *this->_p;
+    const uint64_t i0 = h.lowerBound(toNs(t0));
+    const uint64_t i1 = h.lowerBound(toNs(t1));
+    if (i0 >= i1) return result;
+
+    //Blocos completos [b0, b1) pela árvore, amostras avulsas nas bordas
+    HIST_NODE acc;
+    const uint64_t b0 = (i0 + BLOCK - 1) / BLOCK;
+    const uint64_t b1 = i1 / BLOCK;
+    if (b0 >= b1) h.scan(ch, i0, i1, acc);
+    else
+    {
+        h.scan(ch, i0, b0 * BLOCK, acc);
+        const size_t p0 = b0 % h.nBlocks;
+        const size_t p1 = p0 + (b1 - b0);
+        if (p1 <= h.nBlocks) acc = merge(acc, h.query(ch, p0, p1));
+        else                 acc = merge(merge(acc, h.query(ch, p0, h.nBlocks)), h.query(ch, 0, p1 - h.nBlocks));
+        h.scan(ch, b1 * BLOCK, i1, acc);
+    }
+    if (acc.count == 0) return result;
+
+    result.count = acc.count;
+    result.min   = acc.min;
+    result.max   = acc.max;
+    result.mean  = acc.sum / acc.count;
+    result.last     = h.value(ch, acc.last);
+    result.lastTime = fromNs(h.time[acc.last % h.capacity]);
+    return result;
+}
+
+size_t libOpcTrigaPLCHistory::series(int ch, std::chrono::system_clock::time_point t0, std::chrono::system_clock::time_point t1,
+                                     std::vector<std::chrono::system_clock::time_point>& times, std::vector<float>& values) const
+{
+    times.clear();
+    values.clear();
+    if (ch < 0 || ch >= PLC_N_CHANNELS) return 0;
+
+    std::shared_lock<std::shared_mutex> lock(this->_p->mutex);
+    const libOpcTrigaPLCHistory_private& h = *this->_p;
+    const uint64_t i0 = h.lowerBound(toNs(t0));
+    const uint64_t i1 = h.lowerBound(toNs(t1));
+    for (uint64_t i = i0; i < i1; i++)
+    {
+        if (!h.isValid(ch, i)) continue;
+        times.push_back(fromNs(h.time[i % h.capacity]));
+        values.push_back(h.value(ch, i));
+    }
+    return values.size();
+}
@@ -0,0 +1,409 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <libOpcTrigaPLCManager.h>
+#include "plcChannelData.h"
+#include "errorMsg.h"
+#include <open62541pp/open62541pp.h>
+#include <iostream>
+#include <algorithm>
+#include <random>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+struct libOpcTrigaPLCManager_private;
+
+//Sessão OPC UA de um PLC. Exceto connState, acessada apenas pela thread do gerenciador.
+struct MGR_SESSION
+{
+    libOpcTrigaPLCManager_private* owner;
+    size_t      index;
+    std::string name;
+    std::string serverAddress;
+    PLC_MASK    mask;
+    opcua::Client client;
+
+    //Requisição Read dos canais de mask, montada uma vez em addPlc()
+    std::vector<opcua::NodeId> nodeIds;
+    std::vector<opcua::ReadValueId> readValueIds;
+    std::optional<opcua::ReadRequest> readRequest;
+
+    std::atomic<PLC_CONN_STATE> connState{CONN_DISCONNECTED};
+    std::chrono::steady_clock::time_point retryAt;  //Próxima tentativa de conexão
+    std::chrono::duration<double, std::milli> retryDelay{0}; //Espera após a próxima falha
+    bool     errorReported = false; //Erros são relatados apenas nas mudanças de estado
+    bool     pending = false;       //Leitura enviada e ainda sem resposta
+    uint64_t cycle = 0;             //Ciclo da última leitura enviada
+    std::chrono::steady_clock::time_point sent;
+    PLC_DATA data;                  //Último snapshot do PLC
+};
+
+struct libOpcTrigaPLCManager_private {
+    std::vector<std::unique_ptr<MGR_SESSION>> sessions;
+    MANAGER_CONFIG config;
+    std::minstd_rand rng{std::random_device{}()}; //Jitter das reconexões
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    //Fila única de snapshots de todos os PLCs
+    std::mutex queueMutex;
+    std::condition_variable queueWait;
+    std::deque<PLC_TAGGED_DATA> queue;
+    std::atomic<uint64_t> dropped{0};
+
+    std::mutex errorMutex;
+    std::function<void(const PLC_ERROR&)> errorSink;
+};
+
+static void reportError(MGR_SESSION& s, PLC_ERROR_CODE code, const char* function, const char* message, uint32_t status)
+{
+    libOpcTrigaPLCManager_private* p = s.owner;
+    PLC_ERROR error{code, function, message, s.name.c_str(), status};
+    std::lock_guard<std::mutex> lock(p->errorMutex);
+    if (p->errorSink)
+    {
+        p->errorSink(error);
+        return;
+    }
+    std::cerr << plcErrorMsg("libOpcTrigaPLCManager", function, std::string(message) + " (PLC " + s.name + ")",
+                             status != UA_STATUSCODE_GOOD ? UA_StatusCode_name(status) : "");
+}
+
+//Entrega um snapshot: callback na thread do gerenciador e fila limitada a queueSize
+static void push(libOpcTrigaPLCManager_private* p, const PLC_TAGGED_DATA& tagged)
+{
+    if (p->config.callback) p->config.callback(tagged);
+    {
+        std::lock_guard<std::mutex> lock(p->queueMutex);
+        if (p->config.queueSize == 0) return;
+        if (p->queue.size() >= p->config.queueSize)
+        {
+            p->queue.pop_front();
+            p->dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        p->queue.push_back(tagged);
+    }
+    p->queueWait.notify_one();
+}
+
+//Resposta de uma leitura assíncrona, chamada dentro de UA_Client_run_iterate()
+static void onRead(UA_Client* /*client*/, void* userdata, UA_UInt32 /*requestId*/, UA_ReadResponse* response)
+{
+    MGR_SESSION& s = *static_cast<MGR_SESSION*>(userdata);
+    s.pending = false;
+    if (s.connState == CONN_DISCONNECTED) return; //Leitura cancelada por sessionLost()
+
+    PLC_TAGGED_DATA tagged;
+    tagged.plc   = s.index;
+    tagged.cycle = s.cycle;
+    PLC_DATA_EX& ex = tagged.data;
+    ex.sent     = s.sent;
+    ex.received = std::chrono::steady_clock::now();
+    ex.rtt      = ex.received - ex.sent;
+
+    UA_StatusCode status = response->responseHeader.serviceResult;
+    if (status == UA_STATUSCODE_GOOD && response->resultsSize != s.readValueIds.size()) status = UA_STATUSCODE_BADUNEXPECTEDERROR;
+
+    if (status == UA_STATUSCODE_GOOD)
+    {
+        size_t i = 0;
+        for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+        {
+            if (!(s.mask & (PLC_MASK(1) << ch)))
+            {
+                clearChannel(s.data, ch);
+                continue;
+            }
+            const opcua::DataValue dv(response->results[i++]);
+            ex.time[ch] = channelTime(dv);
+            setChannel(s.data, ch, dv);
+        }
+        s.data.STATE = stateFromStatus(s.data);
+        s.data.STALE = false;
+        s.errorReported = false;
+    }
+    else
+    {
+        if (!s.errorReported) reportError(s, ERR_READ, "onRead()", "Erro ao adquirir dados", status);
+        s.errorReported = true;
+        s.data.STATE = 1;
+        s.data.STALE = true;
+        s.data.MASK  = 0;
+    }
+
+    s.data.TIME = std::chrono::system_clock::now();
+    ex.data = s.data;
+    push(s.owner, tagged);
+}
+
+//Encerra a sessão após uma falha e agenda a próxima tentativa de conexão
+static void sessionLost(MGR_SESSION& s, UA_StatusCode status, const char* function)
+{
+    const PLC_CONN_STATE previous = s.connState.exchange(CONN_DISCONNECTED);
+    UA_Client_disconnect(s.client.handle()); //Leituras pendentes são respondidas com erro
+    s.pending = false;
+
+    //Espera exponencial com jitter, como em libOpcTrigaPLC::enableAutoReconnect(), para
+    //que PLCs que caíram juntos não tentem reconectar todos ao mesmo tempo
+    const RECONNECT_CONFIG& reconnect = s.owner->config.reconnect;
+    std::uniform_real_distribution<double> jitter(1 - reconnect.jitter, 1 + reconnect.jitter);
+    s.retryAt = std::chrono::steady_clock::now() +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(s.retryDelay * jitter(s.owner->rng));
+    s.retryDelay = std::min<std::chrono::duration<double, std::milli>>(s.retryDelay * reconnect.multiplier, reconnect.maxDelay);
+
+    if (previous == CONN_CONNECTED)
+    {
+        reportError(s, ERR_DISCONNECTED, function, "Conexão perdida", status);
+        s.errorReported = true;
+
+        PLC_TAGGED_DATA tagged;
+        tagged.plc   = s.index;
+        tagged.cycle = s.cycle;
+        s.data.STATE = 2;
+        s.data.STALE = true;
+        s.data.MASK  = 0;
+        s.data.TIME  = std::chrono::system_clock::now();
+        tagged.data.data     = s.data;
+        tagged.data.received = std::chrono::steady_clock::now();
+        push(s.owner, tagged);
+    }
+    else if (!s.errorReported)
+    {
+        reportError(s, ERR_CONNECT, function, "Erro ao conectar", status);
+        s.errorReported = true;
+    }
+}
+
+//Início do ciclo de uma sessão: inicia a conexão ou envia a leitura, sem esperar a resposta
+static void sessionStart(MGR_SESSION& s, uint64_t cycle, std::chrono::steady_clock::time_point now)
+{
+    const PLC_CONN_STATE state = s.connState.load();
+    if (state == CONN_DISCONNECTED)
+    {
+        if (now < s.retryAt) return;
+        const UA_StatusCode status = UA_Client_connectAsync(s.client.handle(), s.serverAddress.c_str());
+        if (status != UA_STATUSCODE_GOOD) sessionLost(s, status, "sessionStart()");
+        else                              s.connState = CONN_CONNECTING;
+    }
+    else if (state == CONN_CONNECTED && !s.pending)
+    {
+        s.cycle = cycle;
+        s.sent  = now;
+        const UA_StatusCode status = UA_Client_sendAsyncReadRequest(s.client.handle(), s.readRequest->handle(), onRead, &s, nullptr);
+        if (status != UA_STATUSCODE_GOOD) sessionLost(s, status, "sessionStart()");
+        else                              s.pending = true;
+    }
+}
+
+//true se a sessão aguarda a conclusão da conexão ou a resposta de uma leitura
+static bool sessionBusy(const MGR_SESSION& s)
+{
+    const PLC_CONN_STATE state = s.connState.load();
+    return state == CONN_CONNECTING || (state == CONN_CONNECTED && s.pending);
+}
+
+//Processa a sessão, esperando no máximo timeout por mensagens do servidor (retorna
+//assim que alguma é processada). Retorna true se ainda há conexão ou leitura em andamento.
+static bool sessionIterate(MGR_SESSION& s, std::chrono::milliseconds timeout)
+{
+    if (s.connState == CONN_DISCONNECTED) return false;
+
+    UA_StatusCode status = UA_Client_run_iterate(s.client.handle(), timeout.count());
+    UA_SessionState session = UA_SESSIONSTATE_CLOSED;
+    UA_StatusCode connectStatus = UA_STATUSCODE_GOOD;
+    UA_Client_getState(s.client.handle(), nullptr, &session, &connectStatus);
+    if (status == UA_STATUSCODE_GOOD) status = connectStatus;
+    if (status != UA_STATUSCODE_GOOD)
+    {
+        sessionLost(s, status, "sessionIterate()");
+        return false;
+    }
+
+    if (s.connState == CONN_CONNECTING && session == UA_SESSIONSTATE_ACTIVATED)
+    {
+        s.connState  = CONN_CONNECTED;
+        s.retryDelay = s.owner->config.reconnect.initialDelay;
+    }
+    return sessionBusy(s);
+}
+
+libOpcTrigaPLCManager::libOpcTrigaPLCManager()
+{
+    this->_p = new libOpcTrigaPLCManager_private;
+}
+
+libOpcTrigaPLCManager::~libOpcTrigaPLCManager()
+{
+    stop();
+    delete this->_p;
+}
+
+size_t libOpcTrigaPLCManager::addPlc(std::string name, std::string address, PLC_MASK mask)
+{
+    if (isRunning())
+    {
+        std::cerr << plcErrorMsg("libOpcTrigaPLCManager", "addPlc()", "Gerenciador ativo, PLC " + name + " não acrescentado");
+        return size_t(-1);
+    }
+
+    auto s = std::make_unique<MGR_SESSION>();
+    s->owner         = this->_p;
+    s->index         = this->_p->sessions.size();
+    s->name          = std::move(name);
+    s->serverAddress = "opc.tcp://" + address;
+    s->mask          = mask & PLC_MASK_ALL;
+    for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+    {
+        s->nodeIds.emplace_back(2, PLC_CHANNELS[ch].nodeId);
+        if (s->mask & (PLC_MASK(1) << ch)) s->readValueIds.emplace_back(s->nodeIds[ch], opcua::AttributeId::Value);
+    }
+    s->readRequest.emplace(opcua::RequestHeader{}, 0, opcua::TimestampsToReturn::Both, s->readValueIds);
+    this->_p->sessions.push_back(std::move(s));
+    return this->_p->sessions.size() - 1;
+}
+
+size_t libOpcTrigaPLCManager::size() const
+{
+    return this->_p->sessions.size();
+}
+
+const std::string& libOpcTrigaPLCManager::name(size_t plc) const
+{
+    return this->_p->sessions.at(plc)->name;
+}
+
+PLC_CONN_STATE libOpcTrigaPLCManager::getConnState(size_t plc) const
+{
+    return this->_p->sessions.at(plc)->connState;
+}
+
+bool libOpcTrigaPLCManager::start(MANAGER_CONFIG config)
+{
+    if (this->_p->sessions.empty() || this->_p->running.exchange(true)) return 1;
+    this->_p->config = std::move(config);
+    for (const auto& s : this->_p->sessions)
+    {
+        UA_Client_getConfig(s->client.handle())->timeout = this->_p->config.reconnect.timeoutMs;
+        s->retryAt       = {};
+        s->retryDelay    = this->_p->config.reconnect.initialDelay;
+        s->errorReported = false;
+    }
+    this->_p->thread = std::thread(&libOpcTrigaPLCManager::loop, this);
+    return 0;
+}
+
+void libOpcTrigaPLCManager::stop()
+{
+    this->_p->running = false;
+    if (this->_p->thread.joinable()) this->_p->thread.join();
+    this->_p->queueWait.notify_all();
+}
+
+bool libOpcTrigaPLCManager::isRunning() const
+{
+    return this->_p->running.load(std::memory_order_acquire);
+}
+
+bool libOpcTrigaPLCManager::pop(PLC_TAGGED_DATA& data, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(this->_p->queueMutex);
+    if (!this->_p->queueWait.wait_for(lock, timeout, [this] { return !this->_p->queue.empty(); })) return 1;
+    data = std::move(this->_p->queue.front());
+    this->_p->queue.pop_front();
+    return 0;
+}
+
+size_t libOpcTrigaPLCManager::popAll(std::vector<PLC_TAGGED_DATA>& out)
+{
+    std::lock_guard<std::mutex> lock(this->_p->queueMutex);
+    const size_t n = this->_p->queue.size();
+    out.insert(out.end(), this->_p->queue.begin(), this->_p->queue.end());
+    this->_p->queue.clear();
+    return n;
+}
+
+uint64_t libOpcTrigaPLCManager::dropped() const
+{
+    return this->_p->dropped.load(std::memory_order_relaxed);
+}
+
+void libOpcTrigaPLCManager::setErrorSink(std::function<void(const PLC_ERROR&)> sink)
+{
+    std::lock_guard<std::mutex> lock(this->_p->errorMutex);
+    this->_p->errorSink = std::move(sink);
+}
+
+//Laço da thread do gerenciador: único ponto que acessa os clientes OPC
+void libOpcTrigaPLCManager::loop()
+{
+    using clock = std::chrono::steady_clock;
+    const MANAGER_CONFIG& config = this->_p->config;
+    const clock::duration period = std::chrono::duration_cast<clock::duration>(config.period);
+    uint64_t cycle = 0;
+    clock::time_point deadline = clock::now();
+    while (this->_p->running.load(std::memory_order_acquire))
+    {
+        sleepUntil(deadline);
+
+        //Envia as leituras de todos os PLCs e só então processa as respostas, na ordem
+        //em que chegarem, até todos responderem ou chegar o prazo do próximo ciclo
+        const clock::time_point start = clock::now();
+        for (const auto& s : this->_p->sessions) sessionStart(*s, cycle, start);
+
+        cycle++;
+        deadline += period;
+        const clock::time_point now = clock::now();
+        if (period.count() > 0 && deadline < now)
+        {
+            const auto lost = (now - deadline) / period + 1;
+            cycle    += lost;
+            deadline += lost * period;
+        }
+
+        //Espera bloqueada nos sockets dos clientes, sem varredura ativa: com uma única
+        //sessão ocupada espera nela até o prazo; com várias alterna entre elas, no máximo
+        //pollSlice em cada uma. Sem sessões ocupadas dorme até o próximo ciclo.
+        while (this->_p->running.load(std::memory_order_relaxed))
+        {
+            size_t nBusy = 0;
+            for (const auto& s : this->_p->sessions) nBusy += sessionBusy(*s);
+            auto wait = std::max(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()),
+                                 std::chrono::milliseconds(0));
+            if (nBusy > 1) wait = std::min(wait, config.pollSlice);
+
+            bool busy = false;
+            for (const auto& s : this->_p->sessions)
+                busy |= sessionIterate(*s, sessionBusy(*s) ? wait : std::chrono::milliseconds(0));
+            if (!busy || clock::now() >= deadline) break;
+        }
+    }
+
+    //Desconectada antes do cancelamento: onRead() descarta as leituras pendentes
+    for (const auto& s : this->_p->sessions)
+    {
+        s->connState = CONN_DISCONNECTED;
+        UA_Client_disconnect(s->client.handle());
+        s->pending   = false;
+    }
+}
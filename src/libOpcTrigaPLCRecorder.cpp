@@ -0,0 +1,306 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <libOpcTrigaPLCRecorder.h>
+#include "errorMsg.h"
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char     REC_MAGIC[8]   = {'T','R','I','G','A','R','E','C'};
+static const char     CHUNK_MAGIC[4] = {'C','H','N','K'};
+static const uint32_t REC_VERSION    = 1;
+
+static_assert(sizeof(PLC_RECORD) == 56, "PLC_RECORD deve ter tamanho fixo");
+
+PLC_RECORD plcToRecord(const PLC_DATA& raw)
+{
+    PLC_RECORD rec{};
+    rec.time  = std::chrono::duration_cast<std::chrono::nanoseconds>(raw.TIME.time_since_epoch()).count();
+    rec.mask  = raw.MASK;
+    rec.state = raw.STATE;
+    for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+    {
+        if (PLC_CHANNELS[ch].rawType == RAW_SCALE_BITS) rec.raw[ch] = raw.CLinScale;
+        else                                            rec.raw[ch] = plcField(raw, ch);
+    }
+    return rec;
+}
+
+PLC_DATA recordToPlc(const PLC_RECORD& rec)
+{
+    PLC_DATA raw;
+    raw.TIME  = std::chrono::system_clock::time_point(
+                    std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(rec.time)));
+    raw.MASK  = rec.mask;
+    raw.STATE = rec.state;
+    for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+    {
+        if (PLC_CHANNELS[ch].rawType == RAW_SCALE_BITS) raw.CLinScale = rec.raw[ch];
+        else                                            plcField(raw, ch) = rec.raw[ch];
+    }
+    return raw;
+}
+
+//-------------------------------------------------------------------- Gravação
+
+struct libOpcTrigaPLCRecorder_private {
+    std::ofstream file;
+    std::vector<PLC_RECORD> chunk; //Chunk em andamento, capacidade reservada uma única vez
+    uint32_t chunkCapacity;
+    uint64_t total = 0;
+    std::function<void(const PLC_ERROR&)> errorSink;
+};
+
+libOpcTrigaPLCRecorder::libOpcTrigaPLCRecorder(std::string filename, const CONV_PLC& fatorConv, uint32_t chunkCapacity,
+                                               std::function<void(const PLC_ERROR&)> errorSink)
+{
+    this->_p = new libOpcTrigaPLCRecorder_private;
+    this->_p->errorSink = std::move(errorSink);
+    this->_p->chunkCapacity = std::max<uint32_t>(chunkCapacity, 1);
+    this->_p->chunk.reserve(this->_p->chunkCapacity);
+
+    this->_p->file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!this->_p->file)
+    {
+        plcReportError(this->_p->errorSink, "libOpcTrigaPLCRecorder", ERR_FILE, "libOpcTrigaPLCRecorder()", "Erro ao criar arquivo", filename);
+        return;
+    }
+
+    REC_FILE_HEADER header{};
+    std::memcpy(header.magic, REC_MAGIC, sizeof(REC_MAGIC));
+    header.version       = REC_VERSION;
+    header.nChannels     = PLC_N_CHANNELS;
+    header.recordSize    = sizeof(PLC_RECORD);
+    header.chunkCapacity = this->_p->chunkCapacity;
+    header.fatorConv     = fatorConv;
+    this->_p->file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+libOpcTrigaPLCRecorder::~libOpcTrigaPLCRecorder()
+{
+    flush();
+    delete this->_p;
+}
+
+bool libOpcTrigaPLCRecorder::isOpen() const
+{
+    return this->_p->file.is_open() && this->_p->file.good();
+}
+
+bool libOpcTrigaPLCRecorder::append(const PLC_DATA& raw)
+{
+    if (!isOpen()) return 1;
+    this->_p->chunk.push_back(plcToRecord(raw));
+    this->_p->total++;
+    if (this->_p->chunk.size() >= this->_p->chunkCapacity) return flush();
+    return 0;
+}
+
+bool libOpcTrigaPLCRecorder::flush()
+{
+    if (!isOpen()) return 1;
+    std::vector<PLC_RECORD>& chunk = this->_p->chunk;
+    if (!chunk.empty())
+    {
+        REC_CHUNK_HEADER header{};
+        std::memcpy(header.magic, CHUNK_MAGIC, sizeof(CHUNK_MAGIC));
+        header.count     = chunk.size();
+        header.firstTime = chunk.front().time;
+        header.lastTime  = chunk.front().time;
+        for (const PLC_RECORD& rec : chunk)
+        {
+            header.firstTime = std::min(header.firstTime, rec.time);
+            header.lastTime  = std::max(header.lastTime,  rec.time);
+        }
+        this->_p->file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        this->_p->file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size() * sizeof(PLC_RECORD));
+        chunk.clear();
+    }
+    this->_p->file.flush();
+    if (!this->_p->file)
+    {
+        plcReportError(this->_p->errorSink, "libOpcTrigaPLCRecorder", ERR_FILE, "flush()", "Erro ao gravar arquivo");
+        return 1;
+    }
+    return 0;
+}
+
+uint64_t libOpcTrigaPLCRecorder::size() const
+{
+    return this->_p->total;
+}
+
+void libOpcTrigaPLCRecorder::setErrorSink(std::function<void(const PLC_ERROR&)> sink)
+{
+    this->_p->errorSink = std::move(sink);
+}
+
+//-------------------------------------------------------------------- Leitura
+
+struct REC_CHUNK
+{
+    const PLC_RECORD* records;
+    size_t count;
+    size_t firstIndex; //Índice global da primeira amostra do chunk
+    int64_t firstTime;
+    int64_t lastTime;
+};
+
+struct libOpcTrigaPLCReplay_private {
+    const char* map = nullptr;
+    size_t mapSize = 0;
+    const REC_FILE_HEADER* header = nullptr;
+    std::vector<REC_CHUNK> chunks;
+    size_t total = 0;
+};
+
+libOpcTrigaPLCReplay::libOpcTrigaPLCReplay(std::string filename, std::function<void(const PLC_ERROR&)> errorSink)
+{
+    this->_p = new libOpcTrigaPLCReplay_private;
+
+    const int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(REC_FILE_HEADER))
+    {
+        plcReportError(errorSink, "libOpcTrigaPLCReplay", ERR_FILE, "libOpcTrigaPLCReplay()", "Erro ao abrir arquivo", filename);
+        if (fd >= 0) close(fd);
+        return;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        plcReportError(errorSink, "libOpcTrigaPLCReplay", ERR_FILE, "libOpcTrigaPLCReplay()", "Erro no mmap do arquivo", filename);
+        return;
+    }
+    this->_p->map     = static_cast<const char*>(map);
+    this->_p->mapSize = st.st_size;
+
+    const REC_FILE_HEADER* header = reinterpret_cast<const REC_FILE_HEADER*>(this->_p->map);
+    if (std::memcmp(header->magic, REC_MAGIC, sizeof(REC_MAGIC)) != 0 || header->version != REC_VERSION ||
+        header->nChannels != PLC_N_CHANNELS || header->recordSize != sizeof(PLC_RECORD))
+    {
+        plcReportError(errorSink, "libOpcTrigaPLCReplay", ERR_FILE, "libOpcTrigaPLCReplay()", "Formato inválido", filename);
+        return;
+    }
+    this->_p->header = header;
+
+    //Índice dos chunks; um chunk truncado no fim do arquivo (gravação interrompida) é ignorado
+    size_t offset = sizeof(REC_FILE_HEADER);
+    while (offset + sizeof(REC_CHUNK_HEADER) <= this->_p->mapSize)
+    {
+        const REC_CHUNK_HEADER* chunk = reinterpret_cast<const REC_CHUNK_HEADER*>(this->_p->map + offset);
+        const size_t bytes = (size_t)chunk->count * sizeof(PLC_RECORD);
+        if (std::memcmp(chunk->magic, CHUNK_MAGIC, sizeof(CHUNK_MAGIC)) != 0) break;
+        if (offset + sizeof(REC_CHUNK_HEADER) + bytes > this->_p->mapSize) break;
+
+        const PLC_RECORD* records = reinterpret_cast<const PLC_RECORD*>(this->_p->map + offset + sizeof(REC_CHUNK_HEADER));
+        this->_p->chunks.push_back({records, chunk->count, this->_p->total, chunk->firstTime, chunk->lastTime});
+        this->_p->total += chunk->count;
+        offset += sizeof(REC_CHUNK_HEADER) + bytes;
+    }
+}
+
+libOpcTrigaPLCReplay::~libOpcTrigaPLCReplay()
+{
+    if (this->_p->map) munmap(const_cast<char*>(this->_p->map), this->_p->mapSize);
+    delete this->_p;
+}
+
+bool libOpcTrigaPLCReplay::isOpen() const
+{
+    return this->_p->header != nullptr;
+}
+
+CONV_PLC libOpcTrigaPLCReplay::fatorConv() const
+{
+    if (!this->_p->header) return CONV_PLC{};
+    return this->_p->header->fatorConv;
+}
+
+size_t libOpcTrigaPLCReplay::size() const
+{
+    return this->_p->total;
+}
+
+//Chunk que contém a amostra i
+static const REC_CHUNK& findChunk(const std::vector<REC_CHUNK>& chunks, size_t i)
+{
+    auto it = std::upper_bound(chunks.begin(), chunks.end(), i,
+                               [](size_t index, const REC_CHUNK& c) { return index < c.firstIndex; });
+    return *(it - 1);
+}
+
+const PLC_RECORD& libOpcTrigaPLCReplay::operator[](size_t i) const
+{
+    const REC_CHUNK& chunk = findChunk(this->_p->chunks, i);
+    return chunk.records[i - chunk.firstIndex];
+}
+
+PLC_DATA libOpcTrigaPLCReplay::get(size_t i) const
+{
+    return recordToPlc((*this)[i]);
+}
+
+const PLC_RECORD* libOpcTrigaPLCReplay::span(size_t i, size_t& count) const
+{
+    if (i >= this->_p->total)
+    {
+        count = 0;
+        return nullptr;
+    }
+    const REC_CHUNK& chunk = findChunk(this->_p->chunks, i);
+    count = chunk.count - (i - chunk.firstIndex);
+    return chunk.records + (i - chunk.firstIndex);
+}
+
+//Busca binária: primeiro nos intervalos de tempo dos chunks, depois dentro do chunk
+size_t libOpcTrigaPLCReplay::lowerBound(std::chrono::system_clock::time_point t) const
+{
+    const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    const std::vector<REC_CHUNK>& chunks = this->_p->chunks;
+
+    auto chunk = std::lower_bound(chunks.begin(), chunks.end(), ns,
+                                  [](const REC_CHUNK& c, int64_t time) { return c.lastTime < time; });
+    if (chunk == chunks.end()) return this->_p->total;
+
+    const PLC_RECORD* end = chunk->records + chunk->count;
+    const PLC_RECORD* rec = std::lower_bound(chunk->records, end, ns,
+                                             [](const PLC_RECORD& r, int64_t time) { return r.time < time; });
+    return chunk->firstIndex + (rec - chunk->records);
+}
+
+void libOpcTrigaPLCReplay::column(int ch, size_t begin, size_t end, int16_t* out) const
+{
+    size_t i = begin;
+    while (i < end)
+    {
+        size_t count;
+        const PLC_RECORD* rec = span(i, count);
+        count = std::min(count, end - i);
+        for (size_t k = 0; k < count; k++) *out++ = rec[k].raw[ch];
+        i += count;
+    }
+}
@@ -0,0 +1,291 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <libOpcTrigaPLCShm.h>
+#include "shmRing.h"
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char     SHM_MAGIC[8] = {'T','R','I','G','A','S','H','M'};
+static const uint32_t SHM_VERSION  = 2;
+
+//-------------------------------------------------------------------- Anel
+
+static size_t shmSize(uint32_t nSlots)
+{
+    return sizeof(SHM_HEADER) + size_t(nSlots) * sizeof(SeqSlot<SHM_SAMPLE>);
+}
+
+//Mapeia um segmento existente e confere o formato; nullptr se não existe ou é incompatível
+static SHM_HEADER* mapSegment(const std::string& name, bool writable, size_t& size)
+{
+    const int fd = shm_open(name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+    void* base = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(SHM_HEADER))
+    {
+        size = st.st_size;
+        base = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (base == MAP_FAILED) return nullptr;
+
+    SHM_HEADER* header = static_cast<SHM_HEADER*>(base);
+    const bool valid = std::memcmp(header->magic, SHM_MAGIC, sizeof(SHM_MAGIC)) == 0 &&
+                       header->version    == SHM_VERSION &&
+                       header->nChannels  == PLC_N_CHANNELS &&
+                       header->sampleSize == sizeof(SHM_SAMPLE) &&
+                       size >= shmSize(header->nSlots);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!valid)
+    {
+        munmap(base, size);
+        return nullptr;
+    }
+    return header;
+}
+
+ShmRing::~ShmRing()
+{
+    if (this->base_) munmap(this->base_, this->size_);
+}
+
+ShmRing* ShmRing::create(const std::string& name, uint32_t nSlots)
+{
+    if (nSlots == 0) nSlots = 1;
+
+    //Leitores anexados a um segmento anterior (ex.: publicador que terminou sem fechar)
+    //passam a procurar o novo segmento
+    size_t oldSize;
+    if (SHM_HEADER* old = mapSegment(name, true, oldSize))
+    {
+        old->closed.store(1, std::memory_order_release);
+        munmap(old, oldSize);
+    }
+    shm_unlink(name.c_str());
+
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) return nullptr;
+    const size_t size = shmSize(nSlots);
+    void* base = MAP_FAILED;
+    if (ftruncate(fd, size) == 0) base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    ShmRing* ring  = new ShmRing;
+    ring->name_    = name;
+    ring->base_    = base;
+    ring->size_    = size;
+    ring->owner_   = true;
+    ring->header_  = new (base) SHM_HEADER;
+    ring->slots_   = reinterpret_cast<SeqSlot<SHM_SAMPLE>*>(static_cast<char*>(base) + sizeof(SHM_HEADER));
+    for (uint32_t i = 0; i < nSlots; i++) new (&ring->slots_[i]) SeqSlot<SHM_SAMPLE>;
+
+    ring->header_->version    = SHM_VERSION;
+    ring->header_->nChannels  = PLC_N_CHANNELS;
+    ring->header_->sampleSize = sizeof(SHM_SAMPLE);
+    ring->header_->nSlots     = nSlots;
+    ring->header_->pid        = getpid();
+    //O magic por último: leitores só aceitam o segmento depois de inicializado
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(ring->header_->magic, SHM_MAGIC, sizeof(SHM_MAGIC));
+    return ring;
+}
+
+ShmRing* ShmRing::open(const std::string& name)
+{
+    size_t size;
+    SHM_HEADER* header = mapSegment(name, false, size);
+    if (!header) return nullptr;
+
+    ShmRing* ring = new ShmRing;
+    ring->name_   = name;
+    ring->base_   = header;
+    ring->size_   = size;
+    ring->header_ = header;
+    ring->slots_  = reinterpret_cast<SeqSlot<SHM_SAMPLE>*>(reinterpret_cast<char*>(header) + sizeof(SHM_HEADER));
+    return ring;
+}
+
+void ShmRing::publish(const PLC_DATA& raw, const PLC_DATA& conv)
+{
+    const uint64_t seq = this->header_->head.load(std::memory_order_relaxed) + 1;
+    this->slots_[(seq - 1) % this->header_->nSlots].store(SHM_SAMPLE{seq, raw, conv});
+    this->header_->head.store(seq, std::memory_order_release);
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    this->header_->lastPublish.store(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count(), std::memory_order_release);
+}
+
+void ShmRing::setFatorConv(const CONV_PLC& fatorConv)
+{
+    this->header_->fatorConv.store(fatorConv);
+}
+
+void ShmRing::setPeriod(std::chrono::nanoseconds period)
+{
+    this->header_->period.store(period.count(), std::memory_order_release);
+}
+
+bool ShmRing::alive(uint32_t maxPeriods) const
+{
+    //steady_clock é CLOCK_MONOTONIC, comum a todos os processos da máquina
+    const int64_t period = this->header_->period.load(std::memory_order_acquire);
+    if (period > 0 && maxPeriods > 0)
+    {
+        const int64_t last = this->header_->lastPublish.load(std::memory_order_acquire);
+        const int64_t now  = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        if (last > 0 && now - last > int64_t(maxPeriods) * period) return false;
+    }
+    //EPERM: o processo existe, mas pertence a outro usuário
+    return kill(this->header_->pid, 0) == 0 || errno != ESRCH;
+}
+
+void ShmRing::close()
+{
+    if (!this->owner_) return;
+    this->header_->closed.store(1, std::memory_order_release);
+    shm_unlink(this->name_.c_str());
+    this->owner_ = false;
+}
+
+bool ShmRing::get(uint64_t seq, SHM_SAMPLE& sample) const
+{
+    if (seq == 0 || seq > head()) return false;
+    if (!this->slots_[(seq - 1) % this->header_->nSlots].tryLoad(sample)) return false;
+    return sample.seq == seq;
+}
+
+bool ShmRing::latest(SHM_SAMPLE& sample) const
+{
+    //A amostra mais recente só é sobrescrita depois de nSlots publicações; repete se aconteceu
+    for (int tries = 0; tries < 8; tries++)
+    {
+        const uint64_t seq = head();
+        if (seq == 0) return false;
+        if (get(seq, sample)) return true;
+    }
+    return false;
+}
+
+//-------------------------------------------------------------------- Leitor
+
+struct libOpcTrigaPLCShmReader_private {
+    std::string name;
+    ShmRing* ring = nullptr;
+    SHM_SAMPLE last{}; //Último snapshot lido
+    CONV_PLC lastConv; //Últimos fatores de conversão lidos
+    uint32_t stalePeriods = 5;
+};
+
+libOpcTrigaPLCShmReader::libOpcTrigaPLCShmReader(std::string name)
+{
+    this->_p = new libOpcTrigaPLCShmReader_private;
+    this->_p->name = name;
+    if (attach())
+    {
+        std::cerr << "ERROR in libOpcTrigaPLCShmReader::libOpcTrigaPLCShmReader()\n\tError type: Segmento "
+                  << name << " não encontrado, aguardando o publicador\n";
+    }
+}
+
+libOpcTrigaPLCShmReader::~libOpcTrigaPLCShmReader()
+{
+    delete this->_p->ring;
+    delete this->_p;
+}
+
+//(Re)anexa ao segmento. Retorna 0 em caso de sucesso e 1 se não existe.
+bool libOpcTrigaPLCShmReader::attach()
+{
+    ShmRing* ring = ShmRing::open(this->_p->name);
+    if (!ring) return 1;
+    delete this->_p->ring;
+    this->_p->ring = ring;
+    return 0;
+}
+
+bool libOpcTrigaPLCShmReader::isOpen() const
+{
+    return this->_p->ring && !this->_p->ring->closed();
+}
+
+//Atualiza o último snapshot; sem publicador ativo, ou com o publicador parado no meio
+//de uma publicação, marca os últimos dados como antigos
+void libOpcTrigaPLCShmReader::update()
+{
+    if (!isOpen()) attach();
+
+    SHM_SAMPLE& last = this->_p->last;
+    if (isOpen() && this->_p->ring->alive(this->_p->stalePeriods) && this->_p->ring->latest(last)) return;
+    last.raw.STALE  = true;
+    last.conv.STALE = true;
+    last.raw.STATE  = 2;
+    last.conv.STATE = 2;
+}
+
+PLC_DATA libOpcTrigaPLCShmReader::get_all()
+{
+    update();
+    return this->_p->last.raw;
+}
+
+PLC_DATA libOpcTrigaPLCShmReader::get_all_conv()
+{
+    update();
+    return this->_p->last.conv;
+}
+
+void libOpcTrigaPLCShmReader::setStalePeriods(uint32_t periods)
+{
+    this->_p->stalePeriods = periods;
+}
+
+uint64_t libOpcTrigaPLCShmReader::sequence()
+{
+    if (!isOpen()) attach();
+    return this->_p->ring ? this->_p->ring->head() : 0;
+}
+
+bool libOpcTrigaPLCShmReader::get(uint64_t seq, PLC_DATA& raw, PLC_DATA& conv)
+{
+    SHM_SAMPLE sample;
+    if (!this->_p->ring || !this->_p->ring->get(seq, sample)) return 1;
+    raw  = sample.raw;
+    conv = sample.conv;
+    return 0;
+}
+
+CONV_PLC libOpcTrigaPLCShmReader::fatorConv()
+{
+    if (!isOpen()) attach();
+    if (this->_p->ring) this->_p->ring->fatorConv(this->_p->lastConv);
+    return this->_p->lastConv;
+}
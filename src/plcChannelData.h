@@ -0,0 +1,116 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <libOpcTrigaPLC.h>
+#include <open62541pp/open62541pp.h>
+#include <chrono>
+#include <cerrno>
+#include <ctime>
+
+//Decodificação dos DataValues de cada canal em PLC_DATA e espera em tempo absoluto,
+//comuns a libOpcTrigaPLC e libOpcTrigaPLCManager
+
+//Campo int de um canal RAW_SCALE_BITS em PLC_DATA
+inline int& plcIntField(PLC_DATA& data, int ch)
+{
+    return *reinterpret_cast<int*>(reinterpret_cast<char*>(&data) + PLC_CHANNELS[ch].dataOffset);
+}
+
+//Extrai o valor bruto (Int16 ou UInt16) de um DataValue
+inline bool rawValue(const opcua::DataValue& dv, int32_t& raw)
+{
+    const opcua::Variant& var = dv.getValue();
+    if (var.isType<int16_t>())
+    {
+        raw = var.getScalar<int16_t>();
+        return true;
+    }
+    if (var.isType<uint16_t>())
+    {
+        raw = var.getScalar<uint16_t>();
+        return true;
+    }
+    return false;
+}
+
+//Grava em data o valor e o StatusCode exato do canal ch. Valores Good (inclusive subcódigos
+//como GoodClamped) e Uncertain são mantidos; retorna false se o canal veio com StatusCode Bad.
+inline bool setChannel(PLC_DATA& data, int ch, const opcua::DataValue& dv)
+{
+    int32_t raw = -1;
+    uint32_t status = dv.getStatus().get();
+    if (!UA_StatusCode_isBad(status) && !rawValue(dv, raw)) status = UA_STATUSCODE_BADTYPEMISMATCH;
+    if (UA_StatusCode_isBad(status)) raw = -1;
+    data.STATUS[ch] = status;
+    data.MASK |= PLC_MASK(1) << ch;
+
+    //Bits de escala 0 e 2 (máscara 5): é o que a expressão original raw & 0b00000111 - 2
+    //sempre calculou (o - tem precedência sobre o &). Os valores ficam em 0..5, sem
+    //colidir com -1 (canal não lido).
+    if (PLC_CHANNELS[ch].rawType == RAW_SCALE_BITS) plcIntField(data, ch) = (raw == -1) ? -1 : raw & 0b00000101;
+    else                                            plcField(data, ch) = raw;
+    return !UA_StatusCode_isBad(status);
+}
+
+//Timestamps de origem e do servidor do canal, quando informados
+inline PLC_CHANNEL_TIME channelTime(const opcua::DataValue& dv)
+{
+    PLC_CHANNEL_TIME t;
+    if (dv.hasSourceTimestamp()) t.source = dv.getSourceTimestamp().toTimePoint();
+    if (dv.hasServerTimestamp()) t.server = dv.getServerTimestamp().toTimePoint();
+    return t;
+}
+
+//Marca o canal ch como não atualizado nesta leitura
+inline void clearChannel(PLC_DATA& data, int ch)
+{
+    data.STATUS[ch] = UA_STATUSCODE_BADNODATAAVAILABLE;
+    data.MASK &= ~(PLC_MASK(1) << ch);
+    if (PLC_CHANNELS[ch].rawType == RAW_SCALE_BITS) plcIntField(data, ch) = -1;
+    else                                            plcField(data, ch) = -1;
+}
+
+//STATE de um snapshot a partir do StatusCode de cada canal atualizado (mesma regra de setChannel())
+inline int stateFromStatus(const PLC_DATA& data)
+{
+    int nRead = 0;
+    int nBad = 0;
+    for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+    {
+        if (!(data.MASK & (PLC_MASK(1) << ch))) continue;
+        nRead++;
+        if (UA_StatusCode_isBad(data.STATUS[ch])) nBad++;
+    }
+
+    if (nBad == 0)     return 0;
+    if (nBad == nRead) return 1;
+    return 3;
+}
+
+//Dorme até o instante absoluto t do relógio monotônico (steady_clock = CLOCK_MONOTONIC)
+inline void sleepUntil(std::chrono::steady_clock::time_point t)
+{
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    timespec ts;
+    ts.tv_sec  = ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+}
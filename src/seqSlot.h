@@ -0,0 +1,99 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+//Slot de publicação do tipo seqlock: um único escritor e qualquer número de leitores.
+//O escritor nunca espera; o leitor nunca bloqueia o escritor e apenas repete a cópia
+//se uma publicação aconteceu no meio dela. O valor é guardado em palavras atômicas
+//para que a leitura concorrente seja bem definida.
+//Entre processos o escritor pode morrer ou parar no meio de uma publicação, deixando
+//a sequência ímpar para sempre: leitores de outro processo devem usar tryLoad().
+template <typename T>
+class SeqSlot
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SeqSlot requer tipo trivialmente copiável");
+
+public:
+    SeqSlot()
+    {
+        const T value{};
+        uint64_t buf[N_WORDS] = {};
+        std::memcpy(buf, &value, sizeof(T));
+        for (size_t i = 0; i < N_WORDS; i++)
+            words_[i].store(buf[i], std::memory_order_relaxed);
+    }
+
+    void store(const T& value)
+    {
+        uint64_t buf[N_WORDS] = {};
+        std::memcpy(buf, &value, sizeof(T));
+
+        const uint64_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < N_WORDS; i++)
+            words_[i].store(buf[i], std::memory_order_relaxed);
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    T load() const
+    {
+        T value;
+        while (!tryLoad(value, UINT32_MAX)) {}
+        return value;
+    }
+
+    //Como load(), mas desiste após maxTries cópias interrompidas por uma publicação.
+    //Retorna true em caso de sucesso; em caso de falha value não é alterado.
+    bool tryLoad(T& value, uint32_t maxTries = 4096) const
+    {
+        uint64_t buf[N_WORDS];
+        for (uint32_t tries = 0; tries < maxTries; tries++)
+        {
+            const uint64_t seq0 = seq_.load(std::memory_order_acquire);
+            if (seq0 & 1) continue;
+            for (size_t i = 0; i < N_WORDS; i++)
+                buf[i] = words_[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) != seq0) continue;
+
+            std::memcpy(&value, buf, sizeof(T));
+            return true;
+        }
+        return false;
+    }
+
+    //Número de publicações já feitas
+    uint64_t version() const
+    {
+        return seq_.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    static constexpr size_t N_WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    alignas(64) std::atomic<uint64_t> seq_{0};
+    std::atomic<uint64_t> words_[N_WORDS];
+};
@@ -0,0 +1,96 @@
+/*
+libOpcTrigaPLC is a library to communicate with the Triga PLC
+using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <libOpcTrigaPLC.h>
+#include "seqSlot.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <sys/types.h>
+
+//Layout do segmento de memória compartilhada (POSIX shm_open) do modo publicador:
+//
+//   SHM_HEADER
+//   SeqSlot<SHM_SAMPLE>[nSlots]
+//
+//Anel com um único escritor (o processo publicador). A amostra de número seq
+//(1 = primeira) fica no slot (seq - 1) % nSlots e guarda o próprio número, de modo
+//que o leitor sabe se ela já foi sobrescrita. Todos os campos compartilhados são
+//atômicos e livres de lock, válidos entre processos.
+
+struct SHM_SAMPLE
+{
+    uint64_t seq;
+    PLC_DATA raw;
+    PLC_DATA conv;
+};
+
+struct SHM_HEADER
+{
+    char     magic[8];   //"TRIGASHM", gravado por último na criação
+    uint32_t version;
+    uint32_t nChannels;  //PLC_N_CHANNELS
+    uint32_t sampleSize; //sizeof(SHM_SAMPLE)
+    uint32_t nSlots;
+    pid_t    pid;        //Processo publicador
+    std::atomic<uint32_t> closed{0}; //1 quando o publicador encerra ou o segmento é recriado
+    SeqSlot<CONV_PLC> fatorConv;     //Fatores de conversão em uso pelo publicador
+    std::atomic<int64_t> period{0};  //Período da aquisição do publicador (ns), 0 se não é periódico
+    alignas(64) std::atomic<uint64_t> head{0}; //Amostras publicadas
+    std::atomic<int64_t> lastPublish{0};       //Instante da última publicação (CLOCK_MONOTONIC, ns)
+};
+
+class ShmRing
+{
+public:
+    ~ShmRing();
+
+    //Publicador: (re)cria o segmento name, marcando como fechado um segmento anterior de mesmo nome
+    static ShmRing* create(const std::string& name, uint32_t nSlots);
+    //Leitor: mapeia, somente leitura, um segmento já criado
+    static ShmRing* open(const std::string& name);
+
+    void publish(const PLC_DATA& raw, const PLC_DATA& conv);
+    void setFatorConv(const CONV_PLC& fatorConv);
+    void setPeriod(std::chrono::nanoseconds period);
+    void close(); //Publicador: marca o segmento como fechado e o remove do sistema
+
+    //Leitor: as leituras de slots desistem (retornam false) se o publicador parou no meio
+    //de uma publicação, em vez de esperar por ele
+    bool get(uint64_t seq, SHM_SAMPLE& sample) const;
+    bool latest(SHM_SAMPLE& sample) const;
+    bool fatorConv(CONV_PLC& fatorConv) const { return header_->fatorConv.tryLoad(fatorConv); }
+    uint64_t head() const   { return header_->head.load(std::memory_order_acquire); }
+    bool closed() const     { return header_->closed.load(std::memory_order_acquire); }
+    //Leitor: false se o processo publicador terminou, ou se é periódico e não publica
+    //há mais de maxPeriods períodos
+    bool alive(uint32_t maxPeriods) const;
+
+private:
+    ShmRing() = default;
+
+    std::string name_;
+    void* base_ = nullptr;
+    size_t size_ = 0;
+    bool owner_ = false;
+    SHM_HEADER* header_ = nullptr;
+    SeqSlot<SHM_SAMPLE>* slots_ = nullptr;
+};
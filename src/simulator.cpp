@@ -0,0 +1,215 @@
+/*
+This is a simulated Triga PLC for libOpcTrigaPLC, a library to communicate
+with the Triga PLC using OPC UA client (Ethernet) on a GNU operating system.
+Copyright (C) 2024 Thalles Campagnani
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Servidor OPC UA local que expõe os mesmos NodeIds (ns=2) do PLC da mesa de controle,
+// para testes e benchmarks sem o PLC real. Os valores vêm de formas de onda ou de uma
+// gravação (libOpcTrigaPLCRecorder), e é possível injetar atraso, quedas de conexão e
+// StatusCodes ruins.
+
+#include <libOpcTrigaPLC.h>
+#include <libOpcTrigaPLCRecorder.h>
+#include <open62541pp/open62541pp.h>
+#include <string>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <csignal>
+#include <memory>
+#include <optional>
+
+struct SIM_CONFIG
+{
+    uint16_t    port       = 4840;
+    std::string wave       = "sine"; // sine, ramp, noise ou const
+    double      wavePeriod = 10;     // s
+    int         updateMs   = 10;
+    std::string replay;              // Arquivo de gravação (substitui a forma de onda)
+    int         latencyMs  = 0;      // Atraso adicional em cada iteração do servidor
+    double      dropEvery  = 0;      // s, 0 = nunca
+    int         dropForMs  = 1000;
+    double      badProb    = 0;      // Probabilidade de StatusCode ruim por canal e atualização
+};
+
+static volatile std::sig_atomic_t running = 1;
+
+static void stopHandler(int)
+{
+    running = 0;
+}
+
+static void usage(const char* prog)
+{
+    std::cerr << "Usage: " << prog << " [options]" << std::endl
+              << "  --port <n>          Server port (default 4840)" << std::endl
+              << "  --wave <kind>       sine, ramp, noise or const (default sine)" << std::endl
+              << "  --wave-period <s>   Waveform period (default 10)" << std::endl
+              << "  --update <ms>       Value update interval (default 10)" << std::endl
+              << "  --replay <file>     Replay a libOpcTrigaPLCRecorder file instead of waveforms" << std::endl
+              << "  --latency <ms>      Extra delay on every server iteration" << std::endl
+              << "  --drop-every <s>    Drop all connections (restart the server) every <s> seconds" << std::endl
+              << "  --drop-for <ms>     Server downtime on each drop (default 1000)" << std::endl
+              << "  --bad-prob <p>      Probability of a bad StatusCode per channel and update" << std::endl;
+}
+
+//Valor bruto de um canal na forma de onda, no instante t (s)
+static int16_t waveValue(const SIM_CONFIG& config, int ch, double t, std::mt19937& rng)
+{
+    if (PLC_CHANNELS[ch].rawType == RAW_SCALE_BITS) return (int)(t / config.wavePeriod) % 8;
+
+    const double phase = 2 * M_PI * (t / config.wavePeriod + double(ch) / double(PLC_N_CHANNELS));
+    const double base = 2000;
+    const double amplitude = 1500;
+    if (config.wave == "ramp")  return base + amplitude * (std::fmod(phase, 2 * M_PI) / M_PI - 1);
+    if (config.wave == "noise") return base + std::normal_distribution<double>(0, amplitude / 10)(rng);
+    if (config.wave == "const") return base;
+    return base + amplitude * std::sin(phase);
+}
+
+//Servidor com uma variável por canal
+struct SIM_SERVER
+{
+    opcua::Server server;
+    std::vector<opcua::Node<opcua::Server>> nodes;
+
+    explicit SIM_SERVER(uint16_t port) : server(port)
+    {
+        for (const PLC_CHANNEL_INFO& c : PLC_CHANNELS)
+        {
+            opcua::VariableAttributes attr;
+            attr.setDisplayName({"", c.name});
+            attr.setAccessLevel(UA_ACCESSLEVELMASK_READ);
+            if (c.rawType == RAW_SCALE_BITS) attr.setDataType<uint16_t>().setValueScalar(uint16_t(0));
+            else                             attr.setDataType<int16_t>().setValueScalar(int16_t(0));
+            nodes.push_back(server.getObjectsNode().addVariable({2, c.nodeId}, c.name, attr));
+        }
+    }
+
+    void write(int ch, int16_t raw, UA_StatusCode status)
+    {
+        opcua::DataValue dv;
+        if (PLC_CHANNELS[ch].rawType == RAW_SCALE_BITS) dv.setValue(opcua::Variant::fromScalar(uint16_t(raw)));
+        else                                            dv.setValue(opcua::Variant::fromScalar(raw));
+        dv.setSourceTimestamp(opcua::DateTime::now());
+        dv.setStatus(status);
+        nodes[ch].writeDataValue(dv);
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    SIM_CONFIG config;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        const std::string value = argv[++i];
+        if      (arg == "--port")        config.port       = std::stoi(value);
+        else if (arg == "--wave")        config.wave       = value;
+        else if (arg == "--wave-period") config.wavePeriod = std::stod(value);
+        else if (arg == "--update")      config.updateMs   = std::stoi(value);
+        else if (arg == "--replay")      config.replay     = value;
+        else if (arg == "--latency")     config.latencyMs  = std::stoi(value);
+        else if (arg == "--drop-every")  config.dropEvery  = std::stod(value);
+        else if (arg == "--drop-for")    config.dropForMs  = std::stoi(value);
+        else if (arg == "--bad-prob")    config.badProb    = std::stod(value);
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::unique_ptr<libOpcTrigaPLCReplay> replay;
+    if (!config.replay.empty())
+    {
+        replay = std::make_unique<libOpcTrigaPLCReplay>(config.replay);
+        if (!replay->isOpen() || replay->size() == 0) return 2;
+    }
+
+    std::signal(SIGINT, stopHandler);
+    std::signal(SIGTERM, stopHandler);
+    libOpcTrigaPLC_license();
+
+    std::mt19937 rng(std::random_device{}());
+    std::bernoulli_distribution bad(config.badProb);
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    auto nextUpdate = start;
+    auto nextDrop = start + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(config.dropEvery));
+    size_t replayIndex = 0;
+    bool replayEnd = false;
+    auto replayStart = start;
+
+    while (running)
+    {
+        SIM_SERVER sim(config.port);
+        std::cout << "Simulated PLC listening on opc.tcp://localhost:" << config.port << std::endl;
+
+        while (running)
+        {
+            const auto now = clock::now();
+            if (config.dropEvery > 0 && now >= nextDrop) break;
+
+            if (now >= nextUpdate)
+            {
+                const double t = std::chrono::duration<double>(now - start).count();
+                std::optional<PLC_RECORD> rec;
+                if (replay)
+                {
+                    //Avança na gravação respeitando os intervalos originais. A última amostra é
+                    //servida uma vez e a gravação recomeça na atualização seguinte.
+                    if (replayEnd)
+                    {
+                        replayIndex = 0;
+                        replayStart = now;
+                    }
+                    const int64_t t0 = (*replay)[0].time;
+                    const int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - replayStart).count();
+                    while (replayIndex + 1 < replay->size() && (*replay)[replayIndex + 1].time - t0 <= elapsed) replayIndex++;
+                    rec = (*replay)[replayIndex];
+                    replayEnd = replayIndex + 1 >= replay->size();
+                }
+
+                for (int ch = 0; ch < PLC_N_CHANNELS; ch++)
+                {
+                    const int16_t raw = rec ? rec->raw[ch] : waveValue(config, ch, t, rng);
+                    sim.write(ch, raw, bad(rng) ? UA_STATUSCODE_BADSENSORFAILURE : UA_STATUSCODE_GOOD);
+                }
+                nextUpdate += std::chrono::milliseconds(config.updateMs);
+                if (nextUpdate < now) nextUpdate = now;
+            }
+
+            sim.server.runIterate();
+            if (config.latencyMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(config.latencyMs));
+            else                      std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+
+        if (running && config.dropEvery > 0)
+        {
+            std::cout << "Dropping all connections for " << config.dropForMs << " ms" << std::endl;
+            std::this_thread::sleep_for(std::chrono::milliseconds(config.dropForMs));
+            nextDrop = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(config.dropEvery));
+        }
+    }
+    return 0;
+}